@@ -1,11 +1,20 @@
 #ifndef CMarkdown_H
 #define CMarkdown_H
 
-#include <QString>
+#include <CMarkdownHighlight.h>
+#include <CMarkdownString.h>
+#include <string>
+#include <string_view>
+#include <chrono>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <memory>
+#include <iosfwd>
 
 class CMarkdownBlock;
+class CMarkdownEmitter;
+class CMarkdownLinkDict;
 
 //---
 
@@ -29,6 +38,7 @@ enum class CMarkdownTagType {
   TABLE,
   TR,
   TD,
+  TH,
   HR,
   EM,
   STRONG,
@@ -40,16 +50,17 @@ enum class CMarkdownTagType {
 
 struct CMarkdownTagData {
   CMarkdownTagType type       { CMarkdownTagType::NONE };
-  QString          name;
-  QString          color;
-  QString          font;
+  std::string      name;
+  const char      *cname      { "" }; // name as static string (no allocation)
+  std::string      color;
+  std::string      font;
   bool             singleLine { false };
   bool             recurse    { false };
 
   CMarkdownTagData() { }
 
-  CMarkdownTagData(CMarkdownTagType type, const QString &name) :
-   type(type), name(name) {
+  CMarkdownTagData(CMarkdownTagType type, const char *name) :
+   type(type), name(name), cname(name) {
   }
 };
 
@@ -62,65 +73,289 @@ class CMarkdown {
     TTY
   };
 
+  // table column alignment
+  enum class Align {
+    NONE,
+    LEFT,
+    CENTER,
+    RIGHT
+  };
+
   struct LinkRef {
-    QString ref;
-    QString dest;
-    QString title;
+    std::string ref;
+    std::string dest;
+    std::string title;
+  };
+
+  // source range (zero based lines and columns, end column exclusive)
+  struct SourcePos {
+    int startLine   { -1 };
+    int startColumn { 0 };
+    int endLine     { -1 };
+    int endColumn   { 0 };
+
+    bool isValid() const { return startLine >= 0; }
   };
 
-  using Links    = std::map<QString,LinkRef>;
-  using TagDatas = std::map<CMarkdownTagType,CMarkdownTagData>;
+  // document heading (ATX or setext) in output order
+  struct Heading {
+    int         level { 1 };
+    std::string text;         // heading text (inline markup removed)
+    std::string slug;         // id generated from text (unique in document)
+    int         line  { -1 }; // source line (zero based)
+  };
+
+  // conversion phase (for stats)
+  enum class Phase {
+    NONE,
+    READ,       // split input into lines
+    PREPROCESS, // collect link references
+    PARSE,      // block structure
+    INLINE,     // inline styles (emphasis, links, code spans)
+    EMIT,       // block tags and code block output
+    NUM_PHASES
+  };
+
+  // statistics of last conversion (when enabled)
+  struct Stats {
+    using BlockCounts = std::map<CMarkdownTagType,int>;
+
+    double      times[int(Phase::NUM_PHASES)] { }; // exclusive time (ms) per phase
+    BlockCounts blocks;                            // number of blocks of each type
+    int         lines       { 0 };
+    int         linkLookups { 0 };
+    int         allocations { 0 };                 // blocks, lines and output buffers
+    int64_t     outputBytes { 0 };                 // output size (UTF-8)
+
+    double time(Phase phase) const { return times[int(phase)]; }
+
+    double totalTime() const;
+
+    void reset();
+  };
+
+  using Links     = std::map<std::string,LinkRef>;
+  using TagDatas  = std::map<CMarkdownTagType,CMarkdownTagData>;
+  using BlockEnds = std::vector<int>;
+  using BlockPos  = std::vector<SourcePos>;
+  using LineStart = std::vector<int>;
+  using Headings  = std::vector<Heading>;
+  using Strings   = std::vector<std::string>;
 
  public:
   CMarkdown();
+ ~CMarkdown();
+
+  CMarkdown(const CMarkdown &) = delete;
+  CMarkdown &operator=(const CMarkdown &) = delete;
 
-  //! get/set debug
+  //! get/set debug (print block tree to stderr after conversion)
   bool isDebug() const { return debug_; }
   void setDebug(bool d);
 
-  QString fileToHtml  (const QString &filename);
-  QString fileToTty   (const QString &filename);
-  QString fileToFormat(const QString &filename, Format format);
+  //! get/set highlight fenced code blocks (HTML only)
+  bool isHighlightCode() const { return highlightCode_; }
+  void setHighlightCode(bool b) { highlightCode_ = b; }
+
+  //! code highlighter (caches results between conversions)
+  CMarkdownHighlight &highlight() { return highlight_; }
+
+  //! get/set add data-sourcepos attributes to html block tags
+  bool isSourcePos() const { return sourcePos_; }
+  void setSourcePos(bool b) { sourcePos_ = b; }
+
+  //! get/set add id attributes (heading slugs) to html heading tags
+  bool isHeadingIds() const { return headingIds_; }
+  void setHeadingIds(bool b) { headingIds_ = b; }
+
+  //! get/set replace "[TOC]" lines with list of links to document headings
+  bool isToc() const { return toc_; }
+  void setToc(bool b) { toc_ = b; }
+
+  //! get/set TTY output wrap width (0 for no wrap)
+  int ttyWidth() const { return ttyWidth_; }
+  void setTtyWidth(int w) { ttyWidth_ = w; }
 
-  QString textToHtml  (const QString &str);
-  QString textToTty   (const QString &str);
-  QString textToFormat(const QString &str, Format format);
+  //! get/set stream output is written to as each top level block completes
+  //! (conversion then only returns output not yet written)
+  std::ostream *output() const { return output_; }
+  void setOutput(std::ostream *os) { output_ = os; }
+
+  //! write completed output to output stream (if set)
+  void flushOutput(CMarkdownEmitter &emitter);
+
+  //! get/set collect stats for each conversion (no cost when disabled)
+  bool isStats() const { return statsEnabled_; }
+  void setStats(bool b) { statsEnabled_ = b; }
+
+  //! stats for last conversion
+  const Stats &stats() const { return stats_; }
+
+  //! stats being collected (nullptr if disabled)
+  Stats *statsData() { return (statsEnabled_ ? &stats_ : nullptr); }
+
+  //! switch stats timing to phase (returns previous phase)
+  Phase startPhase(Phase phase);
+
+  //! switch stats timing back to previous phase
+  void endPhase(Phase prev);
+
+  //! convert markdown file ("-" for stdin) or text (UTF-8)
+  std::string fileToHtml  (const std::string &filename);
+  std::string fileToTty   (const std::string &filename);
+  std::string fileToFormat(const std::string &filename, Format format);
+
+  std::string textToHtml  (std::string_view str);
+  std::string textToTty   (std::string_view str);
+  std::string textToFormat(std::string_view str, Format format);
 
   void addLink(const LinkRef &link);
-  bool getLink(const QString &ref, LinkRef &link) const;
+  bool getLink(const std::string &ref, LinkRef &link) const;
+
+  //! get/set shared link definitions (used for references not defined by document)
+  const std::shared_ptr<const CMarkdownLinkDict> &linkDict() const { return linkDict_; }
+  void setLinkDict(const std::shared_ptr<const CMarkdownLinkDict> &dict) { linkDict_ = dict; }
+
+  //! get/set range of top level blocks rendered (end of -1 for no limit). Blocks
+  //! outside the range are parsed into the block skeleton (source ranges) and
+  //! heading index but are not rendered so have no output
+  int renderStart() const { return renderStart_; }
+  int renderEnd  () const { return renderEnd_  ; }
+  void setRenderBlocks(int start, int end) { renderStart_ = start; renderEnd_ = end; }
+
+  //! render top level blocks start to end (exclusive) of last conversion (e.g. blocks
+  //! skipped outside the render range) and return output of each block. Only the
+  //! source lines of each block (from the end of the previous block) are parsed, using
+  //! the link references and heading slugs of the whole document
+  Strings renderBlocks(int start, int end, Format format=Format::HTML);
+
+  //! get/set max nesting depth of block quotes and list items (deeper markers are text)
+  int maxNesting() const { return maxNesting_; }
+  void setMaxNesting(int n) { maxNesting_ = std::max(n, 1); }
+
+  //! check if last conversion skipped blocks outside render range
+  bool isTruncated() const { return truncated_; }
+
+  //! end offset in output of each top level block of last conversion
+  //! (skipped blocks end at end of previous block)
+  const BlockEnds &blockEnds() const { return blockEnds_; }
+
+  //! source range of each top level block of last conversion (block skeleton)
+  const BlockPos &blockSourcePos() const { return blockPos_; }
+
+  void addBlockEnd(int pos, int line);
+
+  //! check if output of current top level block is skipped (outside render range)
+  bool isSkipOutput() const { return skipOutput_; }
+
+  //! mark current top level block as having (skipped) output
+  void setBlockSkipped() { blockSkipped_ = true; }
+
+  //! headings of last conversion (collected while parsing)
+  const Headings &headings() const { return headings_; }
+
+  //! add heading to index, returns its unique slug
+  std::string addHeading(int level, const std::string &text, int line);
+
+  //! add table of contents at output position (filled when all headings known)
+  void addToc(int pos, int line);
+
+  //! insert table of contents at positions added by addToc
+  void fillToc(CMarkdownEmitter &emitter);
+
+  //! get index of top level block containing (or preceding) source line (-1 if none)
+  int sourceLineBlock(int line) const;
+
+  //! get index of top level block containing output position (-1 if none)
+  int outputPosBlock(int pos) const;
+
+  //! get source line containing input offset
+  int offsetLine(int offset) const;
+
+  //! get source range for lines (start of first non-blank to end of last)
+  SourcePos linesSourcePos(int startLine, int endLine) const;
+
+  bool isBlankSourceLine(int line) const;
 
   //---
 
   static bool isSingleLineType(CMarkdownTagType type);
   static bool isRecurseType   (CMarkdownTagType type);
 
-  static QString typeColor(CMarkdownTagType type);
-  static void setTypeColor(CMarkdownTagType type, const QString &color);
+  static std::string typeColor(CMarkdownTagType type);
+  static void setTypeColor(CMarkdownTagType type, const std::string &color);
 
-  static QString typeFont(CMarkdownTagType type);
-  static void setTypeFont(CMarkdownTagType type, const QString &font);
+  static std::string typeFont(CMarkdownTagType type);
+  static void setTypeFont(CMarkdownTagType type, const std::string &font);
 
-  static QString typeName(CMarkdownTagType type);
+  static std::string typeName(CMarkdownTagType type);
 
-  static CMarkdownTagType stringToType(const QString &str);
+  static const char *typeCName(CMarkdownTagType type);
+
+  static CMarkdownTagType stringToType(const std::string &str);
 
   static CMarkdownTagData &getTagData(CMarkdownTagType type);
 
   static TagDatas &getTagDatas();
 
  private:
-  bool readLine(QString &line);
+  bool readLine(std::string &line);
 
- private:
-  using Blocks = std::vector<CMarkdownBlock *>;
+  void addPhaseTime();
+
+  int lineEndOffset(int line) const;
+
+  std::string tocText(Format format) const;
 
-  QString str_;       // input string
-  int     len_ { 0 }; // input string length
-  int     pos_ { 0 }; // input string position
+  std::string sourceLine(int line) const;
 
-  bool            debug_     { false };
-  CMarkdownBlock *rootBlock_ { nullptr };
-  Links           links_;
+ private:
+  using Blocks    = std::vector<CMarkdownBlock *>;
+  using LinkDictP = std::shared_ptr<const CMarkdownLinkDict>;
+  using SlugCount = std::map<std::string,int>;
+  using StatsTime = std::chrono::steady_clock::time_point;
+
+  // table of contents position
+  struct TocPos {
+    int pos  { 0 };  // output position
+    int line { -1 }; // source line
+  };
+
+  using TocPosList = std::vector<TocPos>;
+
+  std::string str_;       // input string (UTF-8)
+  int         len_ { 0 }; // input string length
+  int         pos_ { 0 }; // input string position
+
+  bool               debug_         { false };
+  bool               highlightCode_ { false };
+  bool               sourcePos_     { false };
+  bool               headingIds_    { false };
+  bool               toc_           { false };
+  int                renderStart_   { 0 };
+  int                renderEnd_     { -1 };
+  int                maxNesting_    { 64 };
+  int                ttyWidth_      { 0 };
+  std::ostream      *output_        { nullptr };
+  bool               truncated_     { false };
+  bool               skipOutput_    { false }; // current top level block not rendered
+  bool               blockSkipped_  { false }; // current top level block has skipped output
+  bool               renderBlocks_  { false }; // rendering blocks of last conversion
+  CMarkdownBlock    *rootBlock_     { nullptr };
+  Links              links_;
+  LinkDictP          linkDict_;
+  LineStart          lineStarts_;   // input offset of each line
+  BlockEnds          blockEnds_;
+  BlockPos           blockPos_;
+  int                blockLine_     { 0 }; // first line of pending top level block
+  Headings           headings_;
+  SlugCount          slugCount_;    // number of uses of each slug
+  TocPosList         tocPos_;
+  CMarkdownHighlight highlight_;
+  bool               statsEnabled_  { false };
+  mutable Stats      stats_;        // mutable for lookup counts
+  Phase              statsPhase_    { Phase::NONE };
+  StatsTime          statsStart_;   // start time of current phase
 };
 
 //-------
@@ -128,42 +363,79 @@ class CMarkdown {
 class CMarkdownBlock {
  public:
   struct CodeFence {
-    QChar   c;
-    int     n { 0 };
-    QString info;
+    char        c { '\0' };
+    int         n { 0 };
+    std::string info;
   };
 
   struct LineData {
-    QString line;
-    int     indent { 0 };
-    bool    brk    { false };
-    bool    blank  { true };
+    std::string line;
+    int         indent { 0 };
+    bool        brk    { false };
+    bool        blank  { true };
   };
 
   struct ListData {
-    int     indent { 0 };
-    int     n { 0 };
-    QChar   c;
-    QString text;
+    int  indent { 0 };
+    int  n { 0 };
+    char c { '\0' };
   };
 
   struct Line {
-    QString line;
-    bool    brk { false };
+    std::string     line;
+    bool            brk   { false };
+    int             src   { -1 };      // source line
+    CMarkdownBlock *block { nullptr }; // container parsed from lines (owned)
 
-    Line(const QString &line1, bool brk1=false) :
-     line(line1), brk(brk1) {
+    Line(const std::string &line1, bool brk1=false, int src1=-1) :
+     line(line1), brk(brk1), src(src1) {
     }
   };
 
   struct ATXData {
     CMarkdownTagType type;
-    QString          text;
+    std::string      text;
+  };
+
+  using Lines = std::vector<Line>;
+
+  // code block contents as a range of unprocessed source lines
+  struct CodeSpan {
+    const Lines *lines  { nullptr }; // source lines (owned by parent)
+    int          start  { 0 };       // first line
+    int          end    { 0 };       // end line (exclusive)
+    int          indent { 0 };       // leading columns to strip
+    std::string  lang;               // language (from fence info)
+  };
+
+  // table contents as cell ranges of unprocessed source lines
+  struct TableSpan {
+    struct Cell {
+      int start { 0 }; // start of cell text (trimmed) in line
+      int len   { 0 }; // length of cell text
+    };
+
+    struct Row {
+      int line  { 0 }; // line index
+      int cell  { 0 }; // index of first cell
+      int ncell { 0 }; // number of cells
+    };
+
+    using Cells  = std::vector<Cell>;
+    using Rows   = std::vector<Row>;
+    using Aligns = std::vector<CMarkdown::Align>;
+
+    const Lines *lines   { nullptr }; // source lines (owned by parent)
+    Rows         rows;                // rows (excluding delimiter row)
+    Cells        cells;               // cells of all rows
+    int          columns { 0 };       // number of output columns
+    bool         header  { false };   // first row is header (delimiter row found)
+    Aligns       aligns;              // column alignments (from delimiter row)
   };
 
  public:
-  using Lines   = std::vector<Line>;
-  using LinkRef = CMarkdown::LinkRef;
+  using LinkRef   = CMarkdown::LinkRef;
+  using SourcePos = CMarkdown::SourcePos;
 
  public:
   CMarkdownBlock(CMarkdown *parent);
@@ -181,62 +453,78 @@ class CMarkdownBlock {
 
   void addLine(const Line &line);
 
-  void appendLine(const QString &line);
+  bool hasContent() const;
+
+  const CodeSpan &code() const { return code_; }
+  void setCode(const CodeSpan &code) { code_ = code; }
+
+  const TableSpan &table() const { return table_; }
+  void setTable(const TableSpan &table) { table_ = table; }
+
+  //! get source range of block (including child blocks)
+  SourcePos sourcePos() const;
 
   void preProcess();
 
-  QString process(CMarkdown::Format format);
+  std::string process(CMarkdown::Format format);
+
+  void processBlocks(CMarkdownEmitter &emitter);
+
+  void processLines(CMarkdownEmitter &emitter);
 
-  QString processLines(CMarkdown::Format format);
+  CMarkdownBlock *processContainers();
 
-  QString processList(CMarkdownTagType type, const ListData &list, CMarkdown::Format format);
+  bool isSetTextLine(const std::string &str, CMarkdownTagType &type) const;
 
-  bool isContinuationLine(const QString &str) const;
+  bool isIndentLine(const std::string &str, int &n) const;
 
-  bool isSetTextLine(const QString &str, CMarkdownTagType &type) const;
+  bool isFormatLine(const std::string &str) const;
+  bool isFormatChar(const std::string &str, int i) const;
 
-  bool isIndentLine(const QString &str, int &n) const;
+  bool isStartCodeFence(const std::string &str, CodeFence &fence) const;
+  bool isEndCodeFence(const std::string &str, const CodeFence &fence) const;
 
-  bool isFormatLine(const QString &str) const;
-  bool isFormatChar(const QString &str, int i) const;
+  bool isHtmlLine(const std::string &str) const;
 
-  bool isStartCodeFence(const QString &str, CodeFence &fence) const;
-  bool isEndCodeFence(const QString &str, const CodeFence &fence) const;
+  bool isLinkReference(const std::string &str, LinkRef &link) const;
 
-  bool isHtmlLine(const QString &str) const;
+  bool isBlockQuote(std::string_view str, std::string_view &quote) const;
 
-  bool isLinkReference(const QString &str, LinkRef &link) const;
+  bool isContainerLine(const std::string &str) const;
 
-  bool isBlockQuote(const QString &str, QString &quote) const;
+  bool isUnorderedListLine(std::string_view str, ListData &list) const;
+  bool isOrderedListLine  (std::string_view str, ListData &list) const;
 
-  bool isUnorderedListLine(const QString &str, ListData &list) const;
-  bool isOrderedListLine  (const QString &str, ListData &list) const;
+  bool isTableLine(const std::string &str) const;
 
-  bool isTableLine(const QString &str) const;
+  bool isTocLine(const std::string &str) const;
 
-  void parseTableLine(const QString &str);
+  void addHeading(CMarkdownBlock *block, const std::string &text, int src);
 
-  void parseLine(const QString &line);
+  void addTableRow(TableSpan &table, int line) const;
 
-  QString replaceEmbeddedStyles(const QString &str, bool code, CMarkdown::Format format) const;
+  void parseLine(const std::string &line);
 
-  QString imageSrc(const QString &filename) const;
+  void replaceEmbeddedStyles(const std::string &str, bool code, CMarkdownEmitter &emitter) const;
 
-  void splitLinkRef(const QString &str, QString &href, QString &title) const;
+  std::string imageSrc(const std::string &filename) const;
 
-  QString replaceHtmlChars(const QString &str) const;
+  void splitLinkRef(const std::string &str, std::string &href, std::string &title) const;
 
-  bool isAutoLink(const QString &str, int &i, QString &ref) const;
+  std::string replaceHtmlChars(const std::string &str) const;
 
-  bool isASCIIPunct(const QChar &c) const;
+  bool isAutoLink(const std::string &str, int &i, std::string &ref) const;
+
+  bool isASCIIPunct(char c) const;
 
   bool getLine(LineData &line);
   void ungetLine();
 
   CMarkdownBlock *startBlock(CMarkdownTagType type);
 
-  void addBlockLine(const QString &line, bool brk=false);
-  void appendBlockLine(const QString &line);
+  CMarkdownBlock *createBlock(CMarkdownBlock *parent, CMarkdownTagType type);
+
+  void addBlockLine(const std::string &line, bool brk=false);
 
   void flushBlocks();
 
@@ -244,23 +532,26 @@ class CMarkdownBlock {
 
   void print(int depth=0) const;
 
-  QString toText(CMarkdown::Format format) const;
+  void toText(CMarkdownEmitter &emitter) const;
+
+  void blockStartTag(CMarkdownEmitter &emitter, bool empty=false) const;
 
-  QString anchorText(const QString &ref, const QString &title, const QString &str,
-                     CMarkdown::Format format) const;
+  void anchorText(const std::string &ref, const std::string &title, const std::string &str,
+                  CMarkdownEmitter &emitter) const;
 
-  QString emphasisText(const QString &text, CMarkdown::Format format) const;
-  QString boldText    (const QString &text, CMarkdown::Format format) const;
-  QString strikeText  (const QString &text, CMarkdown::Format format) const;
+  void emphasisText(const std::string &text, CMarkdownEmitter &emitter) const;
+  void boldText    (const std::string &text, CMarkdownEmitter &emitter) const;
+  void strikeText  (const std::string &text, CMarkdownEmitter &emitter) const;
+  void codeText    (const std::string &text, CMarkdownEmitter &emitter) const;
 
-  QString startTag(CMarkdownTagType type, CMarkdown::Format format) const;
-  QString endTag  (CMarkdownTagType type, CMarkdown::Format format) const;
-  QString fullTag (CMarkdownTagType type, CMarkdown::Format format) const;
+  void codeBlockText(CMarkdownEmitter &emitter) const;
 
-  QString htmlStyle(CMarkdownTagType type) const;
+  void tableText(CMarkdownEmitter &emitter) const;
 
-  QString ttyStartStyle(CMarkdownTagType type) const;
-  QString ttyEndStyle  (CMarkdownTagType type) const;
+  int codeLineStart(const std::string &line, int &ns) const;
+
+  void imageText(const std::string &src, const std::string &title, const std::string &alt,
+                 CMarkdownEmitter &emitter) const;
 
  private:
   using Blocks = std::vector<CMarkdownBlock *>;
@@ -270,7 +561,11 @@ class CMarkdownBlock {
   CMarkdownTagType type_      { CMarkdownTagType::ROOT };
   Lines            lines_;
   Blocks           blocks_;
-  QString          processedText_;
+  CodeSpan         code_;
+  TableSpan        table_;
+  int              srcLine_   { -1 };
+  std::string      id_;               // heading id
+  int64_t          traceStart_ { 0 }; // trace time of block start
   bool             processed_ { false };
 
   mutable int currentLine_ { 0 };
@@ -282,24 +577,70 @@ class CMarkdownBlock {
 //------
 
 namespace CMarkdownParse {
-  bool isATXHeader(const QString &str, CMarkdownBlock::ATXData &atxData, int &istart, int &iend);
+  // line type (for editor highlighting)
+  enum class LineType {
+    BLANK,
+    TEXT,
+    HEADER,
+    RULE,
+    LINK_REF,
+    FENCE,
+    CODE,
+    QUOTE,
+    LIST_ITEM,
+    TABLE
+  };
+
+  // block context from previous lines (packed into int for QTextBlock state)
+  struct LineContext {
+    char fenceChar { '\0' };
+    int  fenceLen  { 0 };     // open code fence length (0 if none)
+    bool paragraph { false }; // previous line is paragraph text
+    bool list      { false }; // in list item
+    bool quote     { false }; // in block quote (text line is lazy continuation)
+
+    int toState() const;
+
+    static LineContext fromState(int state);
+  };
+
+  LineType classifyLine(const std::string &str, LineContext &context);
+
+  bool isATXHeader(const std::string &str, CMarkdownBlock::ATXData &atxData, int &istart, int &iend);
+
+  bool isLinkReference(const std::string &str, CMarkdown::LinkRef &linkRef, int &istart, int &iend);
+
+  bool isRule(const std::string &str, int &istart, int &iend);
+
+  bool isStartCodeFence(const std::string &str, CMarkdownBlock::CodeFence &fence);
+  bool isEndCodeFence(const std::string &str, const CMarkdownBlock::CodeFence &fence);
+
+  bool isBlockQuote(std::string_view str, std::string_view &quote);
+
+  bool isUnorderedListLine(std::string_view str, CMarkdownBlock::ListData &list);
+  bool isOrderedListLine  (std::string_view str, CMarkdownBlock::ListData &list);
+
+  bool isTableLine(const std::string &str);
+
+  std::string plainText(const std::string &str);
 
-  bool isLinkReference(const QString &str, CMarkdown::LinkRef &linkRef, int &istart, int &iend);
+  std::string headingSlug(const std::string &text);
 
-  bool isRule(const QString &str, int &istart, int &iend);
+  int parseSurroundText(const std::string &str, int &i, std::string &str1, int &start1);
+  int parseSurroundText(const std::string &str, int &i, char c, std::string &str1, int &start1);
 
-  int parseSurroundText(const QString &str, int &i, QString &str1, int &start1);
-  int parseSurroundText(const QString &str, int &i, const QChar &c, QString &str1, int &start1);
+  int skipSurroundText(const std::string &str, int &i, char c, int len);
 
-  bool isASCIIPunct(const QChar &c);
+  bool isASCIIPunct(char c);
 
-  bool isBlankLine(const QString &str);
+  bool isBlankLine(const std::string &str);
 
-  int skipSpace(const QString &str, int &i);
-  int backSkipSpace(const QString &str, int &i);
+  int skipSpace(std::string_view str, int &i);
+  int skipIndent(const std::string &str, int &i);
+  int backSkipSpace(const std::string &str, int &i);
 
-  int skipChar(const QString &str, int &i, const QChar &c);
-  int backSkipChar(const QString &str, int &i, const QChar &c);
+  int skipChar(const std::string &str, int &i, char c);
+  int backSkipChar(const std::string &str, int &i, char c);
 }
 
 #endif
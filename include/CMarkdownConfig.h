@@ -0,0 +1,11 @@
+#ifndef CMarkdownConfig_H
+#define CMarkdownConfig_H
+
+// Build options of the converter library. Defined here (not in the .pro files) so
+// the library and the applications using its headers are always built with the
+// same settings.
+
+// converter trace events (see CMarkdownTrace.h)
+//#define CMARKDOWN_TRACE
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef CMarkdownConvert_H
+#define CMarkdownConvert_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+
+class CMarkdownLinkDict;
+
+// Markdown conversion interface.
+//
+// Simple functions over the CMarkdown class for programs that only need converted
+// text. Only standard library types are used and text is UTF-8. Link with the
+// CMarkdown core library (no Qt dependency).
+namespace CMarkdownConvert {
+  enum class Format {
+    HTML,
+    TTY
+  };
+
+  struct Options {
+    bool highlightCode { false }; // highlight fenced code blocks (HTML only)
+    bool sourcePos     { false }; // add data-sourcepos attributes
+    bool headingIds    { false }; // add heading id attributes (HTML only)
+    bool toc           { false }; // replace "[TOC]" lines with table of contents
+
+    std::shared_ptr<const CMarkdownLinkDict> links; // shared link definitions (see loadLinks)
+  };
+
+  //! load shared link definitions file (compiled dictionary or markdown) once for use
+  //! by any number of conversions (nullptr if not readable)
+  std::shared_ptr<const CMarkdownLinkDict> loadLinks(const std::string &filename);
+
+  //! convert markdown text
+  std::string convert(std::string_view text, Format format=Format::HTML,
+                      const Options &options=Options());
+
+  //! convert markdown file ("-" for stdin), returns false if not readable
+  bool convertFile(const std::string &filename, std::string &result,
+                   Format format=Format::HTML, const Options &options=Options());
+
+  //! percent encode URL path (UTF-8)
+  std::string encodeUrlPath(std::string_view path);
+}
+
+#endif
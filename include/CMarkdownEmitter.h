@@ -0,0 +1,181 @@
+#ifndef CMarkdownEmitter_H
+#define CMarkdownEmitter_H
+
+#include <CMarkdown.h>
+#include <iosfwd>
+
+// Output buffer used by the HTML and TTY renderers.
+//
+// Tags are written with typed primitives (openTag/attr/endOpenTag/closeTag) so no
+// intermediate format strings are built. Text and attribute values are escaped
+// according to the output format. Output is appended except for placeholders filled
+// when the document is complete (e.g. table of contents).
+//
+// For TTY output block tags control layout: blocks are separated by blank lines,
+// list items get markers, block quotes and code blocks are indented and paragraph
+// text is wrapped to the output width (if set).
+class CMarkdownEmitter {
+ public:
+  using Format = CMarkdown::Format;
+
+  enum class Escape {
+    TEXT, // text node       : & < > "
+    ATTR  // attribute value : & < > " '
+  };
+
+ public:
+  CMarkdownEmitter(Format format=Format::HTML, int reserve=0);
+
+  Format format() const { return format_; }
+
+  bool isHtml() const { return format_ == Format::HTML; }
+
+  const std::string &text() const { return text_; }
+
+  //! return output and reset buffer
+  std::string takeText();
+
+  //! output length in bytes (including output already flushed)
+  int length() const { return flushed_ + int(text_.size()); }
+
+  //! write output to stream (UTF-8) and reset buffer, returns bytes written
+  int64_t flush(std::ostream &os);
+
+  //! size of output not yet flushed (bytes)
+  int64_t textBytes() const;
+
+  //! insert output at position (after output already flushed)
+  void insert(int pos, const std::string &str);
+
+  //! get/set TTY wrap width (0 for no wrap)
+  int width() const { return width_; }
+  void setWidth(int w) { width_ = w; }
+
+  void reserve(int n);
+
+  void clear();
+
+  //---
+
+  // unescaped output
+  void raw(const std::string &str);
+  void raw(char c);
+  void raw(const char *str);
+
+  void newline();
+
+  // hard line break
+  void lineBreak();
+
+  //---
+
+  // escaped output (no escaping for TTY)
+  void text(const std::string &str);
+  void text(const char *data, int len);
+  void text(char c);
+
+  //---
+
+  // HTML tag primitives (ignored for TTY)
+  void openTag(const char *name);
+  void openTag(const std::string &name);
+
+  void attr(const char *name, const std::string &value);
+
+  void styleAttr(CMarkdownTagType type);
+
+  void endOpenTag();
+  void endEmptyTag();
+
+  void closeTag(const char *name);
+  void closeTag(const std::string &name);
+
+  //---
+
+  // typed tags (HTML tag or TTY style)
+  void startTag(CMarkdownTagType type);
+  void endTag  (CMarkdownTagType type);
+  void fullTag (CMarkdownTagType type);
+
+  void ttyStartStyle(CMarkdownTagType type);
+  void ttyEndStyle  (CMarkdownTagType type);
+
+  //! TTY table cell (cell output padded to column width on end, returns width
+  //! of cell output before padding)
+  void ttyStartCell();
+  int  ttyEndCell(int width, CMarkdown::Align align, bool last);
+
+  //! TTY table cell from text rendered separately (of visible width textWidth)
+  void ttyCell(const std::string &text, int textWidth, int width,
+               CMarkdown::Align align, bool last);
+
+  //---
+
+  //! index of first character needing escape in data (len if none)
+  static int findEscape(const char *data, int len, Escape escape);
+
+  //! scalar version of findEscape (used for tail of SIMD scan and as benchmark baseline)
+  static int findEscapeScalar(const char *data, int len, Escape escape);
+
+  static std::string escapeString(const std::string &str, Escape escape=Escape::TEXT);
+
+  //! percent encode URL path (UTF-8, reserved path characters kept)
+  static std::string encodeUrlPath(const std::string &path);
+
+  //! file URL for local file name (file:///abs/path or file:rel/path)
+  static std::string fileUrl(const std::string &filename);
+
+ private:
+  void escapeText(const char *data, int len, Escape escape);
+
+  //---
+
+  // TTY layout
+  void ttyText(const char *data, int len, bool wrap);
+  void ttyEscape(const std::string &str);
+
+  void ttyStartBlock(CMarkdownTagType type);
+  void ttyEndBlock  (CMarkdownTagType type);
+
+  void ttyRule();
+
+  void ttyFlushWord();
+  void ttyStartLine();
+  void ttyEndLine();
+  void ttyBlankLine();
+
+  bool isTtyWrap() const { return width_ > 0 && noWrap_ == 0; }
+
+  static bool isTtyBlockType(CMarkdownTagType type);
+
+ private:
+  // TTY block context (line prefixes)
+  struct TtyBlock {
+    CMarkdownTagType type    { CMarkdownTagType::NONE };
+    std::string      first;             // prefix for first line
+    std::string      rest;              // prefix for following lines
+    bool             started { false }; // first line output
+    int              number  { 0 };     // next item number (OL)
+  };
+
+  using TtyBlocks = std::vector<TtyBlock>;
+
+  Format      format_  { Format::HTML };
+  std::string text_;
+  int         flushed_ { 0 }; // length of output already flushed
+
+  int         width_      { 0 };
+  TtyBlocks   ttyBlocks_;
+  int         noWrap_     { 0 };     // number of unwrapped blocks (PRE, TABLE) in context
+  int         cellPos_    { 0 };     // output position of current table cell
+  int         cellCol_    { 0 };     // column of current table cell
+  std::string word_;                 // pending word (text and escapes)
+  int         wordWidth_  { 0 };     // visible width of pending word
+  int         col_        { 0 };     // column of current line
+  int         indent_     { 0 };     // prefix width of current line
+  bool        lineStart_  { true };  // no output on current line
+  bool        space_      { false }; // space needed before next word
+  bool        blockStart_ { true };  // at start of output or block (no separator needed)
+};
+
+#endif
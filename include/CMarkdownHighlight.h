@@ -0,0 +1,90 @@
+#ifndef CMarkdownHighlight_H
+#define CMarkdownHighlight_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <cstdint>
+
+class CMarkdownEmitter;
+
+// Syntax highlighter for fenced code blocks.
+//
+// Uses a simple built-in tokenizer (keywords, types, strings, numbers, comments) for
+// common languages. Highlighted HTML is cached by language and content hash so
+// unchanged code blocks are not re-tokenized when a document is converted again.
+// Entries not used by a conversion are dropped at the end of it.
+class CMarkdownHighlight {
+ public:
+  enum class TokenType {
+    NONE,
+    KEYWORD,
+    TYPE,
+    STRING,
+    NUMBER,
+    COMMENT,
+    PREPROC
+  };
+
+  struct Language {
+    using Names   = std::set<std::string>;
+    using Strings = std::vector<std::string>;
+
+    std::string name;
+    Names       keywords;
+    Names       types;
+    Strings     lineComments;       // line comment start strings
+    std::string blockCommentStart;  // block comment start string
+    std::string blockCommentEnd;    // block comment end string
+    std::string quotes;             // string quote characters
+    bool        preproc { false };  // '#' at line start is preprocessor directive
+  };
+
+ public:
+  CMarkdownHighlight();
+
+  //! get language for fenced code info name (nullptr if not supported)
+  static const Language *getLanguage(const std::string &name);
+
+  //! write highlighted code to emitter (cached)
+  bool highlight(const std::string &lang, const std::string &code, CMarkdownEmitter &emitter);
+
+  //! start/end conversion (end removes entries not used since start)
+  void startPass();
+  void endPass();
+
+  void clear();
+
+  int numEntries() const { return int(cache_.size()); }
+
+ private:
+  void tokenize(const Language &language, const std::string &code, CMarkdownEmitter &emitter) const;
+
+  static const char *tokenColor(TokenType type);
+
+ private:
+  struct Key {
+    std::string lang;
+    uint64_t    hash { 0 };
+    int         len  { 0 };
+
+    bool operator<(const Key &rhs) const {
+      if (hash != rhs.hash) return (hash < rhs.hash);
+      if (len  != rhs.len ) return (len  < rhs.len );
+      return (lang < rhs.lang);
+    }
+  };
+
+  struct Entry {
+    std::string html;
+    int         pass { 0 };
+  };
+
+  using Cache = std::map<Key,Entry>;
+
+  Cache cache_;
+  int   pass_ { 0 };
+};
+
+#endif
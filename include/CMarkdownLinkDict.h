@@ -0,0 +1,62 @@
+#ifndef CMarkdownLinkDict_H
+#define CMarkdownLinkDict_H
+
+#include <CMarkdown.h>
+#include <string>
+#include <cstdint>
+
+// Shared read-only link reference definitions.
+//
+// Definitions ("[ref]: dest "title"") common to many documents are loaded once and
+// consulted by CMarkdown::getLink after the document's own definitions. They are
+// stored as an open addressing hash table with a UTF-8 string pool in one buffer. A
+// compiled dictionary file (see save) is memory mapped read-only so loading it does
+// no parsing or copying and its pages are shared between processes; a markdown file
+// of definitions is parsed once into the same layout.
+//
+// Lookups do not modify the dictionary so one instance can be shared by any number
+// of conversions and threads.
+class CMarkdownLinkDict {
+ public:
+  using LinkRef = CMarkdown::LinkRef;
+
+ public:
+  CMarkdownLinkDict();
+ ~CMarkdownLinkDict();
+
+  CMarkdownLinkDict(const CMarkdownLinkDict &) = delete;
+  CMarkdownLinkDict &operator=(const CMarkdownLinkDict &) = delete;
+
+  //! load compiled dictionary (mapped) or markdown definitions file (parsed)
+  bool load(const std::string &filename);
+
+  //! build from markdown definitions text (later definitions of a reference replace earlier)
+  void build(const std::string &text);
+
+  //! save compiled dictionary
+  bool save(const std::string &filename) const;
+
+  //! check if data is a mapped file
+  bool isMapped() const { return mapped_; }
+
+  int numLinks() const;
+
+  //! get link for reference (case insensitive)
+  bool getLink(const std::string &ref, LinkRef &link) const;
+
+  void clear();
+
+ private:
+  struct Header;
+  struct Entry;
+
+  bool setData(const char *data, size_t size);
+
+ private:
+  std::string buffer_;              // built dictionary data
+  const char *data_   { nullptr }; // dictionary data (buffer or mapped file)
+  size_t      size_   { 0 };
+  bool        mapped_ { false };
+};
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef CMarkdownString_H
+#define CMarkdownString_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// String helpers for the converter (UTF-8 std::string).
+//
+// Character classes are ASCII only (as markdown syntax is) and bytes of multi-byte
+// UTF-8 sequences count as letters so non-ASCII words are kept together. Case
+// conversion (reference and slug matching) also handles common alphabets.
+namespace CMarkdownString {
+  inline bool isSpace(char c) {
+    return (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v');
+  }
+
+  inline bool isDigit(char c) { return (c >= '0' && c <= '9'); }
+
+  inline bool isAlpha(char c) {
+    return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || uint8_t(c) >= 0x80);
+  }
+
+  inline bool isAlnum(char c) { return (isAlpha(c) || isDigit(c)); }
+
+  //! check for continuation byte of multi-byte UTF-8 sequence
+  inline bool isContinuation(char c) { return (uint8_t(c) & 0xC0) == 0x80; }
+
+  //! decode UTF-8 character starting at i (i moved past it). Invalid bytes are
+  //! decoded as single characters
+  inline uint32_t decodeUtf8(std::string_view str, size_t &i) {
+    uint8_t c = uint8_t(str[i++]);
+
+    int n = (c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0);
+
+    if (n == 0 || i + n > str.size())
+      return c;
+
+    uint32_t u = c & (0x3F >> n);
+
+    for (int j = 0; j < n; ++j) {
+      if (! isContinuation(str[i + j]))
+        return c;
+
+      u = (u << 6) | (uint8_t(str[i + j]) & 0x3F);
+    }
+
+    i += n;
+
+    return u;
+  }
+
+  inline void encodeUtf8(uint32_t u, std::string &str) {
+    if      (u < 0x80)
+      str += char(u);
+    else if (u < 0x800) {
+      str += char(0xC0 | (u >> 6));
+      str += char(0x80 | (u & 0x3F));
+    }
+    else if (u < 0x10000) {
+      str += char(0xE0 | (u >> 12));
+      str += char(0x80 | ((u >> 6) & 0x3F));
+      str += char(0x80 | (u & 0x3F));
+    }
+    else {
+      str += char(0xF0 | (u >> 18));
+      str += char(0x80 | ((u >> 12) & 0x3F));
+      str += char(0x80 | ((u >> 6) & 0x3F));
+      str += char(0x80 | (u & 0x3F));
+    }
+  }
+
+  inline char toLower(char c) { return (c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c); }
+
+  //! lower case of character (ASCII, Latin-1, Latin Extended-A, Greek and Cyrillic)
+  inline uint32_t lowerChar(uint32_t u) {
+    if      (u < 0x80)
+      return uint32_t(toLower(char(u)));
+    else if ((u >= 0xC0 && u <= 0xDE && u != 0xD7) ||
+             (u >= 0x391 && u <= 0x3AB && u != 0x3A2) ||
+             (u >= 0x410 && u <= 0x42F))
+      return u + 0x20;
+    else if (u >= 0x400 && u <= 0x40F)
+      return u + 0x50;
+    else if (u == 0x178)
+      return 0xFF;
+    else if (u >= 0x100 && u <= 0x17F && u != 0x130 && u != 0x138 && u != 0x149 && u != 0x17F)
+      return ((u >= 0x139 && u <= 0x148) || u >= 0x179 ? u + (u & 1) : u | 1);
+    else
+      return u;
+  }
+
+  //! check for non-ASCII punctuation or symbol character (spaces, Latin-1 symbols,
+  //! general punctuation to miscellaneous symbols, CJK and full width punctuation)
+  inline bool isSymbolChar(uint32_t u) {
+    return ((u >= 0x80 && u <= 0xBF) || u == 0xD7 || u == 0xF7 ||
+            (u >= 0x2000 && u <= 0x2BFF) || (u >= 0x3000 && u <= 0x303F) ||
+            (u >= 0xFE10 && u <= 0xFE6F) || (u >= 0xFF01 && u <= 0xFF0F));
+  }
+
+  inline std::string toLower(std::string_view str) {
+    std::string str1;
+
+    str1.reserve(str.size());
+
+    for (size_t i = 0; i < str.size(); ) {
+      if (uint8_t(str[i]) < 0x80) {
+        str1 += toLower(str[i++]);
+        continue;
+      }
+
+      size_t i1 = i;
+
+      uint32_t u  = decodeUtf8(str, i);
+      uint32_t lu = lowerChar(u);
+
+      if (lu != u)
+        encodeUtf8(lu, str1);
+      else
+        str1.append(str, i1, i - i1);
+    }
+
+    return str1;
+  }
+
+  inline bool startsWith(std::string_view str, std::string_view match) {
+    return (str.size() >= match.size() && str.compare(0, match.size(), match) == 0);
+  }
+
+  inline bool endsWith(std::string_view str, std::string_view match) {
+    return (str.size() >= match.size() &&
+            str.compare(str.size() - match.size(), match.size(), match) == 0);
+  }
+
+  //! index of character at or after pos (-1 if not found)
+  inline int indexOf(std::string_view str, char c, int pos=0) {
+    auto p = str.find(c, size_t(pos));
+
+    return (p != std::string_view::npos ? int(p) : -1);
+  }
+
+  //! substring from pos of (at most) n bytes (empty if pos past end, rest if n < 0)
+  inline std::string mid(std::string_view str, int pos, int n=-1) {
+    if (pos < 0 || size_t(pos) >= str.size())
+      return std::string();
+
+    return std::string(str.substr(size_t(pos), n < 0 ? std::string_view::npos : size_t(n)));
+  }
+
+  //! string with leading and trailing spaces removed
+  inline std::string trimmed(std::string_view str) {
+    size_t i1 = 0, i2 = str.size();
+
+    while (i1 < i2 && isSpace(str[i1    ])) ++i1;
+    while (i2 > i1 && isSpace(str[i2 - 1])) --i2;
+
+    return std::string(str.substr(i1, i2 - i1));
+  }
+
+  //! string with leading and trailing spaces removed and inner runs of spaces
+  //! replaced by a single space
+  inline std::string simplified(std::string_view str) {
+    std::string str1;
+
+    str1.reserve(str.size());
+
+    bool space = false;
+
+    for (const auto &c : str) {
+      if (isSpace(c)) {
+        space = ! str1.empty();
+        continue;
+      }
+
+      if (space)
+        str1 += ' ';
+
+      str1 += c;
+
+      space = false;
+    }
+
+    return str1;
+  }
+
+  //! split at separator character (empty parts skipped)
+  inline std::vector<std::string> split(std::string_view str, char sep) {
+    std::vector<std::string> strs;
+
+    size_t i = 0, len = str.size();
+
+    while (i < len) {
+      size_t j = str.find(sep, i);
+
+      if (j == std::string_view::npos)
+        j = len;
+
+      if (j > i)
+        strs.push_back(std::string(str.substr(i, j - i)));
+
+      i = j + 1;
+    }
+
+    return strs;
+  }
+
+  //! number of characters (code points) in UTF-8 text (visible width for TTY output)
+  inline int width(const char *data, int len) {
+    int n = 0;
+
+    for (int i = 0; i < len; ++i)
+      if (! isContinuation(data[i]))
+        ++n;
+
+    return n;
+  }
+
+  inline int width(std::string_view str) { return width(str.data(), int(str.size())); }
+
+  //! 64 bit FNV-1a hash of UTF-8 data (stored in link dictionary files so must not change)
+  inline uint64_t hashString(std::string_view str) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (char c : str) {
+      hash ^= uint8_t(c);
+      hash *= 1099511628211ULL;
+    }
+
+    return hash;
+  }
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef CMarkdownTrace_H
+#define CMarkdownTrace_H
+
+#include <CMarkdownConfig.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iosfwd>
+
+// Trace event recorder for the converter.
+//
+// Events are written as Chrome trace JSON (chrome://tracing or ui.perfetto.dev) with
+// one complete ('X') event per timed scope or block and instant ('i') events for
+// single points. Trace macros are compiled out unless CMARKDOWN_TRACE is defined in
+// CMarkdownConfig.h (shared so library and applications always match), and when
+// compiled in nothing is recorded until tracing is enabled.
+//
+// Events are recorded for the calling thread only (not thread safe).
+class CMarkdownTrace {
+ public:
+  struct Event {
+    const char *cat { nullptr };
+    std::string name;
+    char        ph  { 'X' };
+    int64_t     ts  { 0 };    // start time (ns)
+    int64_t     dur { 0 };    // duration (ns)
+    std::string detail;
+  };
+
+  using Events = std::vector<Event>;
+
+ public:
+  static CMarkdownTrace &instance();
+
+  //! get/set record events
+  static bool isEnabled() { return enabled_; }
+  static void setEnabled(bool b) { enabled_ = b; }
+
+  //! current time (ns since first use)
+  static int64_t now();
+
+  //! add event for range started at ts and ending now
+  void complete(const char *cat, const std::string &name, int64_t ts,
+                const std::string &detail=std::string());
+
+  //! add event at current time
+  void instant(const char *cat, const std::string &name, const std::string &detail=std::string());
+
+  const Events &events() const { return events_; }
+
+  void clear();
+
+  //! write events as Chrome trace JSON
+  void write(std::ostream &os) const;
+
+  bool save(const std::string &filename) const;
+
+ private:
+  CMarkdownTrace() { }
+
+ private:
+  static bool enabled_;
+
+  Events events_;
+};
+
+//---
+
+// timed scope (event added on scope exit). Name is a static string so nothing is
+// allocated when tracing is disabled
+class CMarkdownTraceScope {
+ public:
+  CMarkdownTraceScope(const char *cat, const char *name) :
+   cat_(cat), name_(name), active_(CMarkdownTrace::isEnabled()) {
+    if (active_)
+      ts_ = CMarkdownTrace::now();
+  }
+
+ ~CMarkdownTraceScope() {
+    if (active_)
+      CMarkdownTrace::instance().complete(cat_, name_, ts_, detail_);
+  }
+
+  bool isActive() const { return active_; }
+
+  void setDetail(const std::string &detail) { detail_ = detail; }
+
+ private:
+  const char *cat_    { nullptr };
+  const char *name_   { nullptr };
+  bool        active_ { false };
+  int64_t     ts_     { 0 };
+  std::string detail_;
+};
+
+//---
+
+#ifdef CMARKDOWN_TRACE
+#define CMARKDOWN_TRACE_CONCAT1(a, b) a##b
+#define CMARKDOWN_TRACE_CONCAT(a, b) CMARKDOWN_TRACE_CONCAT1(a, b)
+
+// timed scope with detail string (only evaluated when tracing)
+#define CMARKDOWN_TRACE_SCOPE(cat, name, detail) \
+  CMarkdownTraceScope CMARKDOWN_TRACE_CONCAT(traceScope, __LINE__)(cat, name); \
+  if (CMARKDOWN_TRACE_CONCAT(traceScope, __LINE__).isActive()) \
+    CMARKDOWN_TRACE_CONCAT(traceScope, __LINE__).setDetail(detail)
+
+// event for range started at ts (from CMARKDOWN_TRACE_NOW)
+#define CMARKDOWN_TRACE_COMPLETE(cat, name, ts, detail) \
+  do { if (CMarkdownTrace::isEnabled()) \
+         CMarkdownTrace::instance().complete(cat, name, ts, detail); } while (0)
+
+#define CMARKDOWN_TRACE_INSTANT(cat, name, detail) \
+  do { if (CMarkdownTrace::isEnabled()) \
+         CMarkdownTrace::instance().instant(cat, name, detail); } while (0)
+
+#define CMARKDOWN_TRACE_NOW() \
+  (CMarkdownTrace::isEnabled() ? CMarkdownTrace::now() : 0)
+#else
+#define CMARKDOWN_TRACE_SCOPE(cat, name, detail)
+#define CMARKDOWN_TRACE_COMPLETE(cat, name, ts, detail) do { } while (0)
+#define CMARKDOWN_TRACE_INSTANT(cat, name, detail) do { } while (0)
+#define CMARKDOWN_TRACE_NOW() 0
+#endif
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <QFrame>
 #include <QTextEdit>
+#include <QElapsedTimer>
 
 class CQMarkdown;
 class CQMarkdownEditToolBar;
@@ -11,6 +12,7 @@ class CQMarkdownEditSyntaxHighlight;
 
 class QTimer;
 class QToolButton;
+class QMimeData;
 
 class CQMarkdownEdit : public QFrame {
   Q_OBJECT
@@ -23,6 +25,9 @@ class CQMarkdownEdit : public QFrame {
   QString text() const;
   void setText(const QString &text);
 
+  //! current preview update delay (ms) (adapted to preview update time)
+  int updateDelay() const { return updateDelay_; }
+
   QSize sizeHint() const override;
 
  public slots:
@@ -38,18 +43,25 @@ class CQMarkdownEdit : public QFrame {
   void linkSlot();
   void imageSlot();
 
+  //! move cursor to start of line (zero based) and show it
+  void gotoLine(int line);
+
  private:
   QString removeListChars(const QString &str) const;
 
  private slots:
   void updateSlot();
+  void updateTimeoutSlot();
   void selectionSlot();
 
  private:
-  CQMarkdown            *markdown_ { nullptr };
-  CQMarkdownEditToolBar *toolbar_  { nullptr };
-  CQMarkdownEditText    *edit_     { nullptr };
-  QTimer                *timer_    { nullptr };
+  CQMarkdown            *markdown_      { nullptr };
+  CQMarkdownEditToolBar *toolbar_       { nullptr };
+  CQMarkdownEditText    *edit_          { nullptr };
+  QTimer                *timer_         { nullptr };
+  int                    updateDelay_   { 100 };     // preview update delay (ms)
+  bool                   updatePending_ { false };   // preview update pending
+  QElapsedTimer          pendingTime_;               // time since update requested
 };
 
 //------
@@ -91,8 +103,14 @@ class CQMarkdownEditText : public QTextEdit {
  public:
   CQMarkdownEditText(CQMarkdownEdit *edit);
 
+  //! set text (large text highlighted in time slices)
+  void loadText(const QString &text);
+
   void keyPressEvent(QKeyEvent *e) override;
 
+ protected:
+  void insertFromMimeData(const QMimeData *source) override;
+
  private:
   CQMarkdownEdit                *edit_        { nullptr };
   CQMarkdownEditSyntaxHighlight *highlighter_ { nullptr };
@@ -0,0 +1,68 @@
+#ifndef CQMarkdownImageCache_H
+#define CQMarkdownImageCache_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QDateTime>
+#include <QUrl>
+
+template<typename T> class QFutureWatcher;
+
+// Decoded image cache for the preview.
+//
+// Image URLs are resolved to file paths once. Files are decoded on a worker thread
+// and kept in an LRU cache limited by a memory budget, so images are not re-read or
+// re-decoded when the preview document is rebuilt. A file is decoded again only when
+// its modification time or size changes. Images larger than half the budget are
+// scaled down when decoded so they can be cached, and files which fail to decode are
+// not decoded again until they change.
+class CQMarkdownImageCache : public QObject {
+  Q_OBJECT
+
+ public:
+  CQMarkdownImageCache(QObject *parent=nullptr);
+
+  //! get/set memory budget (KB)
+  int maxCost() const { return images_.maxCost(); }
+  void setMaxCost(int kb) { images_.setMaxCost(kb); }
+
+  //! check if url is handled by cache (local file)
+  static bool isImageUrl(const QUrl &url);
+
+  //! get decoded image for url (null image and decode started if not loaded)
+  QImage image(const QUrl &url);
+
+  int numImages() const { return images_.count(); }
+
+  void clear();
+
+ signals:
+  //! emitted when decode of image for url has completed
+  void imageLoaded(const QUrl &url);
+
+ private:
+  struct ImageData {
+    QImage    image;
+    QDateTime mtime;
+    qint64    size { 0 };
+  };
+
+  void startDecode(const QString &key, const QString &path);
+
+  static int imageCost(const QImage &image);
+
+ private:
+  using Images  = QCache<QString,ImageData>;
+  using Paths   = QHash<QString,QString>;
+  using Pending = QHash<QString,QFutureWatcher<QImage> *>;
+  using Failed  = QHash<QString,ImageData>;
+
+  Images  images_;  // decoded images (LRU, cost in KB)
+  Paths   paths_;   // resolved file path for url
+  Pending pending_; // decodes in progress
+  Failed  failed_;  // file details of failed decodes (null image)
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef CQMarkdownOutline_H
+#define CQMarkdownOutline_H
+
+#include <CMarkdown.h>
+#include <QTreeWidget>
+#include <vector>
+
+// Document outline (headings nested by level).
+//
+// Set from the heading index of the preview conversion so the text is never parsed
+// again for the outline. When an update has the same heading levels (e.g. typing in
+// a heading or paragraph) the existing items are updated in place, keeping their
+// expansion and selection; otherwise the tree is rebuilt.
+class CQMarkdownOutline : public QTreeWidget {
+  Q_OBJECT
+
+ public:
+  CQMarkdownOutline(QWidget *parent=nullptr);
+
+  //! update from headings of conversion
+  void setHeadings(const CMarkdown::Headings &headings);
+
+ signals:
+  //! emitted when heading clicked (zero based source line)
+  void lineSelected(int line);
+
+ private slots:
+  void itemClickedSlot(QTreeWidgetItem *item, int column);
+
+ private:
+  using Items  = std::vector<QTreeWidgetItem *>;
+  using Levels = std::vector<int>;
+
+  Items  items_;  // item of each heading (document order)
+  Levels levels_; // level of each heading
+};
+
+#endif
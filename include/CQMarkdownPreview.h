@@ -7,25 +7,87 @@
 #include <map>
 
 class CQMarkdown;
+class CQMarkdownImageCache;
+class CQMarkdownRefRenderer;
 
 #ifdef USE_WEB_VIEW
 class QWebView;
 #endif
 
 class QTextEdit;
+class QTextCursor;
+class QUrl;
 
 class CQMarkdownPreview : public QTabWidget {
+  Q_OBJECT
+
  public:
   CQMarkdownPreview(CQMarkdown *markdown, bool ref=false);
 
+  //! html shown in preview (may be partial for large documents)
   const QString &html() const { return html_; }
 
+  //! html for complete document (converted once per update if preview is partial)
+  QString fullHtml() const;
+
+  //! headings of last update (whole document, including blocks not rendered)
+  const CMarkdown::Headings &headings() const { return mark_.headings(); }
+
   void updateText();
 
+  //! update current tab if out of date
+  void updateCurrent();
+
+  //! time (ms) of last update
+  double updateTime() const { return updateTime_; }
+
+  CQMarkdownImageCache *imageCache() const { return imageCache_; }
+
   QSize sizeHint() const override;
 
  private:
-  CQMarkdown *markdown_;
+#ifndef USE_WEB_VIEW
+  void patchHtml();
+
+  void renderBlocks(int start, int end);
+
+  int htmlBlockStart(int i) const;
+
+  QStringRef htmlBlock(int i) const;
+  QStringRef docBlock (int i) const;
+
+  void insertHtmlBlocks(QTextCursor &cursor, int j1, int j2);
+
+  void updateBlockHeights();
+
+  int estimateBlockHeight(int i, int lineSpacing) const;
+
+  int docBlockTop(int i) const;
+
+  int docPosBlock(int pos) const;
+
+  bool visibleBlocks(int &first, int &last) const;
+#endif
+
+ signals:
+  //! emitted after update (with update time)
+  void textUpdated(double ms);
+
+ private slots:
+  void currentChangedSlot(int ind);
+
+  void scrollSlot();
+
+  void renderSlot();
+
+  void refRenderedSlot(const QString &text, const QString &html);
+
+  void imageLoadedSlot(const QUrl &url);
+
+ private:
+  CQMarkdown            *markdown_    { nullptr };
+  CQMarkdownImageCache  *imageCache_  { nullptr };
+  CQMarkdownRefRenderer *refRenderer_ { nullptr };
 
 #ifdef USE_WEB_VIEW
   QWebView   *markHtmlEdit_ { nullptr };
@@ -39,6 +101,42 @@ class CQMarkdownPreview : public QTabWidget {
   QTextEdit  *refTextEdit_  { nullptr };
   CMarkdown   mark_;
   QString     html_;
+
+  // range of each top level block in html (current conversion and in html document).
+  // Blocks reference the html so no copies are kept (docHtml_ shares html_ when current)
+  struct BlockRange {
+    int start  { 0 };
+    int length { 0 };
+  };
+
+  using BlockRanges = std::vector<BlockRange>;
+
+  BlockRanges htmlBlocks_;
+  QString     docHtml_;
+  BlockRanges docBlocks_;
+  std::vector<int> docBlockStarts_;  // document position of each top level block
+  std::vector<int> docBlockHeights_; // fixed height of unrendered blocks (0 if rendered)
+
+  // html of complete document (when preview partial)
+  mutable QString fullHtml_;
+  mutable bool    fullHtmlValid_ { false };
+
+  // range of top level blocks rendered for large documents (end of -1 for all).
+  // Other blocks are empty document blocks with their estimated height
+  int         renderStart_   { 0 };
+  int         renderEnd_     { -1 };
+  bool        renderPending_ { false };
+
+  double      updateTime_    { 0.0 };
+
+  // tabs needing update when next shown
+  QString     refSrc_;
+  QString     refHtml_;
+  bool        markHtmlDirty_ { false };
+  bool        markTextDirty_ { false };
+  bool        refDirty_      { false }; // reference command not run for refSrc_
+  bool        refHtmlDirty_  { false };
+  bool        refTextDirty_  { false };
 };
 
 #endif
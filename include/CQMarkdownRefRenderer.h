@@ -0,0 +1,72 @@
+#ifndef CQMarkdownRefRenderer_H
+#define CQMarkdownRefRenderer_H
+
+#include <QObject>
+#include <QCache>
+#include <QStringList>
+
+class QProcess;
+
+// Reference markdown renderer used by the preview compare mode.
+//
+// Runs the reference command (CQMARKDOWN_EXEC, default "markdown") asynchronously
+// and caches results by content hash (source text compared on lookup) so unchanged
+// text is never rendered twice.
+// Only one command runs at a time; requests made while it runs are coalesced into
+// a single run of the latest text.
+//
+// Any command which reads markdown on stdin and writes html to stdout can be used,
+// e.g. the command line converter as an offline stand-in:
+// CQMARKDOWN_EXEC="CQMarkdownMain -html -"
+class CQMarkdownRefRenderer : public QObject {
+  Q_OBJECT
+
+ public:
+  CQMarkdownRefRenderer(QObject *parent=nullptr);
+
+  //! get/set command (program and arguments)
+  const QStringList &command() const { return command_; }
+  void setCommand(const QStringList &command) { command_ = command; }
+
+  //! get/set cache budget (KB)
+  int maxCost() const { return cache_.maxCost(); }
+  void setMaxCost(int kb) { cache_.setMaxCost(kb); }
+
+  //! get html for text (returns true if cached, otherwise starts render)
+  bool render(const QString &text, QString &html);
+
+  bool isRunning() const { return (process_ != nullptr); }
+
+  void clear();
+
+ signals:
+  //! emitted when render of last requested text completes
+  void rendered(const QString &text, const QString &html);
+
+ private:
+  void startProcess(const QString &text);
+
+  void processFinished(QProcess *process);
+
+  static quint64 textKey(const QString &text);
+
+ private:
+  // cached html and its source text (hash collisions are misses)
+  struct Entry {
+    QString text;
+    QString html;
+  };
+
+  using Cache = QCache<quint64,Entry>;
+
+  QStringList command_;
+  Cache       cache_;
+  QProcess   *process_ { nullptr }; // running command
+  quint64     runKey_  { 0 };       // key of text being rendered
+  QString     runText_;             // text being rendered
+  QString     pending_;             // text to render when command finishes
+  bool        hasPending_ { false };
+  QString     lastText_;            // last requested text
+};
+
+#endif
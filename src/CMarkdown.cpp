@@ -1,16 +1,97 @@
 #include <CMarkdown.h>
-#include <QFile>
-#include <QTextStream>
-#include <QUrl>
+#include <CMarkdownEmitter.h>
+#include <CMarkdownLinkDict.h>
+#include <CMarkdownTrace.h>
+#include <CMarkdownString.h>
+#include <algorithm>
 #include <set>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <cassert>
+#include <climits>
+#include <cstdlib>
+
+namespace {
+
+// check for character which may start an inline construct
+inline bool isInlineChar(char c, bool code) {
+  switch (c) {
+    case '\\': case '<': case '\t':
+      return true;
+    case '*': case '_': case '~': case '`': case '!': case '[':
+      return ! code;
+    default:
+      return false;
+  }
+}
+
+// read UTF-8 text from stream (BOM skipped and CRLF converted to LF)
+bool readText(std::istream &is, std::string &str) {
+  std::stringstream ss;
+
+  ss << is.rdbuf();
+
+  std::string data = ss.str();
+
+  if (is.bad())
+    return false;
+
+  const char *p = data.c_str();
+  size_t      n = data.size();
+
+  if (n >= 3 && p[0] == '\xEF' && p[1] == '\xBB' && p[2] == '\xBF') {
+    p += 3; n -= 3;
+  }
+
+  str.clear();
+
+  str.reserve(n);
+
+  for (size_t i = 0; i < n; ++i) {
+    if (p[i] == '\r' && i < n - 1 && p[i + 1] == '\n')
+      continue;
+
+    str += p[i];
+  }
+
+  return true;
+}
+
+// time scope in conversion phase (nothing done when stats disabled)
+class PhaseScope {
+ public:
+  PhaseScope(CMarkdown *markdown, CMarkdown::Phase phase) :
+   markdown_(markdown->isStats() ? markdown : nullptr) {
+    if (markdown_)
+      prev_ = markdown_->startPhase(phase);
+  }
+
+ ~PhaseScope() {
+    if (markdown_)
+      markdown_->endPhase(prev_);
+  }
+
+ private:
+  CMarkdown        *markdown_ { nullptr };
+  CMarkdown::Phase  prev_     { CMarkdown::Phase::NONE };
+};
+
+}
+
+//---
 
 CMarkdown::
 CMarkdown()
 {
 }
 
+CMarkdown::
+~CMarkdown()
+{
+  delete rootBlock_;
+}
+
 void
 CMarkdown::
 setDebug(bool d)
@@ -18,2288 +99,3609 @@ setDebug(bool d)
   debug_ = d;
 }
 
-QString
+std::string
 CMarkdown::
-fileToHtml(const QString &filename)
+fileToHtml(const std::string &filename)
 {
   return fileToFormat(filename, Format::HTML);
 }
 
-QString
+std::string
 CMarkdown::
-fileToTty(const QString &filename)
+fileToTty(const std::string &filename)
 {
   return fileToFormat(filename, Format::TTY);
 }
 
-QString
+std::string
 CMarkdown::
-fileToFormat(const QString &filename, Format format)
+fileToFormat(const std::string &filename, Format format)
 {
-  QFile file(filename);
+  std::string str;
 
-  if (! file.open(QFile::ReadOnly | QFile::Text))
-    return "";
+  // "-" reads from stdin
+  if (filename == "-") {
+    if (! readText(std::cin, str))
+      return "";
+  }
+  else {
+    std::ifstream is(filename, std::ios::binary);
 
-  QTextStream stream(&file);
+    if (! is || ! readText(is, str))
+      return "";
+  }
 
-  return textToFormat(stream.readAll(), format);
+  return textToFormat(str, format);
 }
 
-QString
+std::string
 CMarkdown::
-textToHtml(const QString &str)
+textToHtml(std::string_view str)
 {
   return textToFormat(str, Format::HTML);
 }
 
-QString
+std::string
 CMarkdown::
-textToTty(const QString &str)
+textToTty(std::string_view str)
 {
   return textToFormat(str, Format::TTY);
 }
 
-QString
+std::string
 CMarkdown::
-textToFormat(const QString &str, Format format)
+textToFormat(std::string_view str, Format format)
 {
   delete rootBlock_;
 
   rootBlock_ = new CMarkdownBlock(this);
 
+  blockEnds_ .clear();
+  blockPos_  .clear();
+  lineStarts_.clear();
+
+  blockLine_    = 0;
+  truncated_    = false;
+  skipOutput_   = false;
+  blockSkipped_ = false;
+
+  headings_ .clear();
+  slugCount_.clear();
+  tocPos_   .clear();
+
+  Stats *stats = statsData();
+
+  if (stats) {
+    stats->reset();
+
+    statsPhase_ = Phase::NONE;
+
+    statsStart_ = std::chrono::steady_clock::now();
+
+    ++stats->blocks[CMarkdownTagType::DOCUMENT];
+    ++stats->allocations;
+  }
+
   //---
 
   str_ = str;
   pos_ = 0;
-  len_ = str_.length();
+  len_ = int(str_.size());
 
-  QString line;
+  CMARKDOWN_TRACE_SCOPE("convert", "textToFormat", std::to_string(len_) + " bytes");
 
-  while (readLine(line))
-    rootBlock_->addLine(line);
+  // split into lines
+  {
+    PhaseScope scope(this, Phase::READ);
 
-  rootBlock_->preProcess();
+    CMARKDOWN_TRACE_SCOPE("convert", "read", std::string());
 
-  return rootBlock_->process(format);
-}
+    std::string line;
+
+    int lineNum = 0;
+
+    while (true) {
+      int pos = pos_;
+
+      if (! readLine(line))
+        break;
+
+      lineStarts_.push_back(pos);
+
+      rootBlock_->addLine(CMarkdownBlock::Line(line, false, lineNum++));
+    }
+  }
+
+  // collect link references
+  {
+    PhaseScope scope(this, Phase::PREPROCESS);
+
+    CMARKDOWN_TRACE_SCOPE("convert", "preProcess", std::string());
+
+    rootBlock_->preProcess();
+  }
+
+  if (isHighlightCode())
+    highlight_.startPass();
+
+  std::string res = rootBlock_->process(format);
 
-void
-CMarkdown::
-addLink(const LinkRef &link)
-{
   if (isDebug())
-    std::cerr << "DEBUG: Add Link: [" << link.ref.toStdString() << "]:" <<
-                 link.dest.toStdString() << " " <<
-                 "'" << link.title.toStdString() << "'\n";
+    rootBlock_->print();
+
+  // drop cached highlight for code blocks no longer in document
+  if (isHighlightCode())
+    highlight_.endPass();
 
-  links_[link.ref.toLower()] = link;
+  if (stats) {
+    stats->lines        = int(lineStarts_.size());
+    stats->allocations += stats->lines;
+  }
+
+  return res;
 }
 
-bool
+// render blocks using source line ranges of block skeleton. Skeleton, heading index and
+// render range of the whole document conversion are kept
+CMarkdown::Strings
 CMarkdown::
-getLink(const QString &ref, LinkRef &link) const
+renderBlocks(int start, int end, Format format)
 {
-  if (isDebug())
-    std::cerr << "DEBUG: Get Link: " << ref.toStdString() << "\n";
+  Strings strs;
 
-  QString lref = ref.toLower();
+  int nb = int(blockPos_.size());
 
-  auto p = links_.find(lref);
+  start = std::max(start, 0);
+  end   = std::min(end, nb);
 
-  if (p == links_.end())
-    return false;
+  if (start >= end)
+    return strs;
 
-  link = (*p).second;
+  CMARKDOWN_TRACE_SCOPE("convert", "renderBlocks", std::to_string(end - start) + " blocks");
 
-  return true;
-}
+  BlockEnds blockEnds;
+  BlockPos  blockPos;
 
-bool
-CMarkdown::
-readLine(QString &line)
-{
-  if (pos_ >= len_)
-    return false;
+  std::swap(blockEnds, blockEnds_);
+  std::swap(blockPos , blockPos_ );
 
-  line = "";
+  CMarkdownBlock *rootBlock = rootBlock_;
 
-  while (pos_ < len_ && str_[pos_] != '\n')
-    line += str_[pos_++];
+  int           renderStart = renderStart_;
+  int           renderEnd   = renderEnd_;
+  bool          truncated   = truncated_;
+  std::ostream *output      = output_;
 
-  if (pos_ < len_ && str_[pos_] == '\n')
-    ++pos_;
+  renderStart_  = 0;
+  renderEnd_    = -1;
+  output_       = nullptr;
+  renderBlocks_ = true;
 
-  return true;
-}
+  for (int i = start; i < end; ++i) {
+    const SourcePos &pos = blockPos[i];
 
-//------
+    if (! pos.isValid()) {
+      strs.push_back("");
+      continue;
+    }
 
-bool
+    // lines after previous block have no output of their own (blank lines and
+    // link definitions) except a table of contents which is output with this block
+    int startLine = pos.startLine;
+
+    if (i > 0 && blockPos[i - 1].isValid())
+      startLine = std::min(blockPos[i - 1].endLine + 1, startLine);
+
+    rootBlock_ = new CMarkdownBlock(this);
+
+    for (int line = startLine; line <= pos.endLine; ++line)
+      rootBlock_->addLine(CMarkdownBlock::Line(sourceLine(line), false, line));
+
+    blockLine_    = startLine;
+    skipOutput_   = false;
+    blockSkipped_ = false;
+
+    strs.push_back(rootBlock_->process(format));
+
+    delete rootBlock_;
+
+    blockEnds_.clear();
+    blockPos_ .clear();
+  }
+
+  std::swap(blockEnds, blockEnds_);
+  std::swap(blockPos , blockPos_ );
+
+  rootBlock_    = rootBlock;
+  renderStart_  = renderStart;
+  renderEnd_    = renderEnd;
+  truncated_    = truncated;
+  output_       = output;
+  renderBlocks_ = false;
+
+  return strs;
+}
+
+void
 CMarkdown::
-isSingleLineType(CMarkdownTagType type)
+flushOutput(CMarkdownEmitter &emitter)
 {
-  const CMarkdownTagData &data = CMarkdown::getTagData(type);
+  // output held until table of contents filled
+  if (! output_ || ! tocPos_.empty())
+    return;
 
-  return data.singleLine;
+  int64_t n = emitter.flush(*output_);
+
+  output_->flush();
+
+  Stats *stats = statsData();
+
+  if (stats)
+    stats->outputBytes += n;
 }
 
-bool
+CMarkdown::Phase
 CMarkdown::
-isRecurseType(CMarkdownTagType type)
+startPhase(Phase phase)
 {
-  const CMarkdownTagData &data = CMarkdown::getTagData(type);
+  Phase prev = statsPhase_;
 
-  return data.recurse;
+  addPhaseTime();
+
+  statsPhase_ = phase;
+
+  return prev;
 }
 
-QString
+void
 CMarkdown::
-typeColor(CMarkdownTagType type)
+endPhase(Phase prev)
 {
-  const CMarkdownTagData &data = CMarkdown::getTagData(type);
+  addPhaseTime();
 
-  return data.color;
+  statsPhase_ = prev;
 }
 
+// add time since last phase change to current phase
 void
 CMarkdown::
-setTypeColor(CMarkdownTagType type, const QString &color)
+addPhaseTime()
 {
-  CMarkdownTagData &data = CMarkdown::getTagData(type);
+  StatsTime t = std::chrono::steady_clock::now();
 
-  data.color = color;
+  stats_.times[int(statsPhase_)] +=
+    std::chrono::duration<double, std::milli>(t - statsStart_).count();
+
+  statsStart_ = t;
 }
 
-QString
-CMarkdown::
-typeFont(CMarkdownTagType type)
+double
+CMarkdown::Stats::
+totalTime() const
 {
-  const CMarkdownTagData &data = CMarkdown::getTagData(type);
+  double t = 0.0;
 
-  return data.font;
+  for (int i = int(Phase::READ); i < int(Phase::NUM_PHASES); ++i)
+    t += times[i];
+
+  return t;
 }
 
 void
-CMarkdown::
-setTypeFont(CMarkdownTagType type, const QString &font)
+CMarkdown::Stats::
+reset()
 {
-  CMarkdownTagData &data = CMarkdown::getTagData(type);
-
-  data.font = font;
+  *this = Stats();
 }
 
-CMarkdownTagType
+// add end of top level block output and next source line, and check if the
+// next top level block is rendered
+void
 CMarkdown::
-stringToType(const QString &str)
+addBlockEnd(int pos, int line)
 {
-  QString lstr = str.toLower();
+  // ignore top level lines with no output
+  if (pos > (blockEnds_.empty() ? 0 : blockEnds_.back()) || blockSkipped_) {
+    if (blockSkipped_)
+      truncated_ = true;
 
-  const TagDatas &tagDatas = CMarkdown::getTagDatas();
+    blockEnds_.push_back(pos);
 
-  for (const auto &p : tagDatas) {
-    const CMarkdownTagData &tagData = p.second;
+    // source lines since last call (excluding trailing blank lines)
+    int endLine = line - 1;
 
-    if (tagData.name == lstr)
-      return tagData.type;
+    while (endLine > blockLine_ && isBlankSourceLine(endLine))
+      --endLine;
+
+    blockPos_.push_back(linesSourcePos(blockLine_, endLine));
   }
 
-  return CMarkdownTagType::NONE;
+  blockLine_    = line;
+  blockSkipped_ = false;
+
+  int i = int(blockEnds_.size());
+
+  skipOutput_ = (i < renderStart_ || (renderEnd_ >= 0 && i >= renderEnd_));
 }
 
-QString
+int
 CMarkdown::
-typeName(CMarkdownTagType type)
+sourceLineBlock(int line) const
 {
-  const CMarkdownTagData &data = getTagData(type);
+  if (blockPos_.empty())
+    return -1;
 
-  return data.name;
+  // last block starting at or before line
+  auto p = std::upper_bound(blockPos_.begin(), blockPos_.end(), line,
+             [](int l, const SourcePos &pos) { return l < pos.startLine; });
+
+  if (p == blockPos_.begin())
+    return 0;
+
+  return int(p - blockPos_.begin()) - 1;
 }
 
-CMarkdownTagData &
+int
 CMarkdown::
-getTagData(CMarkdownTagType type)
+outputPosBlock(int pos) const
 {
-  TagDatas &tagDatas = getTagDatas();
+  auto p = std::upper_bound(blockEnds_.begin(), blockEnds_.end(), pos);
 
-  auto p = tagDatas.find(type);
-  assert(p != tagDatas.end());
+  if (p == blockEnds_.end())
+    return -1;
 
-  return (*p).second;
+  return int(p - blockEnds_.begin());
 }
 
-CMarkdown::TagDatas &
+int
 CMarkdown::
-getTagDatas()
+offsetLine(int offset) const
 {
-  static TagDatas tagDatas;
+  auto p = std::upper_bound(lineStarts_.begin(), lineStarts_.end(), offset);
 
-  if (tagDatas.empty()) {
-    auto addTagData = [&](CMarkdownTagType type, const QString &typeName,
-                          bool singleLine, bool recurse) {
-      CMarkdownTagData data(type, typeName);
+  return std::max(int(p - lineStarts_.begin()) - 1, 0);
+}
 
-      data.singleLine = singleLine;
-      data.recurse    = recurse;
+CMarkdown::SourcePos
+CMarkdown::
+linesSourcePos(int startLine, int endLine) const
+{
+  SourcePos pos;
 
-      tagDatas[type] = data;
-    };
+  int nl = int(lineStarts_.size());
 
-    //---
+  if (startLine < 0 || startLine >= nl || endLine < startLine)
+    return pos;
 
-    //         type,                         name,         singleLine, recurse
-    addTagData(CMarkdownTagType::DOCUMENT  , "document"  , false     , true );
-    addTagData(CMarkdownTagType::P         , "p"         , true      , false);
-    addTagData(CMarkdownTagType::BLOCKQUOTE, "blockquote", false     , true );
-    addTagData(CMarkdownTagType::H1        , "h1"        , true      , false);
-    addTagData(CMarkdownTagType::H2        , "h2"        , true      , false);
-    addTagData(CMarkdownTagType::H3        , "h3"        , true      , false);
-    addTagData(CMarkdownTagType::H4        , "h4"        , true      , false);
-    addTagData(CMarkdownTagType::H5        , "h5"        , true      , false);
-    addTagData(CMarkdownTagType::H6        , "h6"        , true      , false);
-    addTagData(CMarkdownTagType::UL        , "ul"        , false     , false);
-    addTagData(CMarkdownTagType::OL        , "ol"        , false     , false);
-    addTagData(CMarkdownTagType::LI        , "li"        , true      , true );
-    addTagData(CMarkdownTagType::PRE       , "pre"       , false     , true );
-    addTagData(CMarkdownTagType::CODE      , "code"      , false     , false);
-    addTagData(CMarkdownTagType::TABLE     , "table"     , false     , true );
-    addTagData(CMarkdownTagType::TR        , "tr"        , false     , false);
-    addTagData(CMarkdownTagType::TD        , "td"        , false     , false);
-    addTagData(CMarkdownTagType::HR        , "hr"        , true      , false);
-    addTagData(CMarkdownTagType::EM        , "em"        , false     , false);
-    addTagData(CMarkdownTagType::STRONG    , "strong"    , false     , false);
-    addTagData(CMarkdownTagType::STRIKE    , "strike"    , false     , false);
-    addTagData(CMarkdownTagType::A         , "a"         , false     , false);
-  }
+  if (endLine >= nl)
+    endLine = nl - 1;
 
-  return tagDatas;
-}
+  // start at first non-blank character
+  int i1 = lineStarts_[startLine];
+  int i2 = lineEndOffset(startLine);
 
-//------
+  int i = i1;
 
-CMarkdownBlock::
-CMarkdownBlock(CMarkdown *markdown) :
- markdown_(markdown), parent_(nullptr), type_(CMarkdownTagType::DOCUMENT)
-{
+  while (i < i2 && CMarkdownString::isSpace(str_[i]))
+    ++i;
+
+  pos.startLine   = startLine;
+  pos.startColumn = (i < i2 ? i - i1 : 0);
+  pos.endLine     = endLine;
+  pos.endColumn   = lineEndOffset(endLine) - lineStarts_[endLine];
+
+  return pos;
 }
 
-CMarkdownBlock::
-CMarkdownBlock(CMarkdownBlock *parent, CMarkdownTagType type) :
- markdown_(nullptr), parent_(parent), type_(type)
+bool
+CMarkdown::
+isBlankSourceLine(int line) const
 {
+  int nl = int(lineStarts_.size());
+
+  if (line < 0 || line >= nl)
+    return true;
+
+  int i2 = lineEndOffset(line);
+
+  for (int i = lineStarts_[line]; i < i2; ++i)
+    if (! CMarkdownString::isSpace(str_[i]))
+      return false;
+
+  return true;
 }
 
-CMarkdownBlock::
-~CMarkdownBlock()
+// get source line text (excluding newline)
+std::string
+CMarkdown::
+sourceLine(int line) const
 {
-  for (auto &b : blocks_)
-    delete b;
+  return str_.substr(size_t(lineStarts_[line]), size_t(lineEndOffset(line) - lineStarts_[line]));
 }
 
-void
-CMarkdownBlock::
-addBlock(CMarkdownBlock *block)
+// get input offset of end of line (excluding newline)
+int
+CMarkdown::
+lineEndOffset(int line) const
 {
-  blocks_.push_back(block);
+  int nl = int(lineStarts_.size());
+
+  if (line < nl - 1)
+    return lineStarts_[line + 1] - 1;
+
+  return (len_ > 0 && str_[len_ - 1] == '\n' ? len_ - 1 : len_);
 }
 
-void
-CMarkdownBlock::
-addLine(const Line &line)
+// add heading to index. Repeated slugs get a "-1", "-2", ... suffix (skipping
+// slugs already used by other headings).
+std::string
+CMarkdown::
+addHeading(int level, const std::string &text, int line)
 {
-  lines_.push_back(line);
+  // rendering blocks again so heading already in index (slug of heading at line)
+  if (renderBlocks_) {
+    auto p = std::lower_bound(headings_.begin(), headings_.end(), line,
+               [](const Heading &heading, int l) { return heading.line < l; });
+
+    if (p != headings_.end() && (*p).line == line)
+      return (*p).slug;
+
+    return CMarkdownParse::headingSlug(CMarkdownParse::plainText(text));
+  }
+
+  Heading heading;
+
+  heading.level = level;
+  heading.text  = CMarkdownParse::plainText(text);
+  heading.slug  = CMarkdownParse::headingSlug(heading.text);
+  heading.line  = line;
+
+  auto p = slugCount_.find(heading.slug);
+
+  if (p != slugCount_.end()) {
+    std::string slug;
+
+    do {
+      slug = heading.slug + "-" + std::to_string((*p).second++);
+    } while (slugCount_.find(slug) != slugCount_.end());
+
+    heading.slug = slug;
+  }
+
+  slugCount_[heading.slug] = 1;
+
+  headings_.push_back(heading);
+
+  return heading.slug;
 }
 
 void
-CMarkdownBlock::
-appendLine(const QString &line)
+CMarkdown::
+addToc(int pos, int line)
 {
-  assert(! lines_.empty());
+  TocPos toc;
 
-  lines_.back().line += line;
+  toc.pos  = pos;
+  toc.line = line;
+
+  tocPos_.push_back(toc);
 }
 
+// insert table of contents at each position (output after position held until now)
+// and move following block ends to include it
 void
-CMarkdownBlock::
+CMarkdown::
+fillToc(CMarkdownEmitter &emitter)
+{
+  if (tocPos_.empty())
+    return;
+
+  std::string text = tocText(emitter.format());
+
+  // last position first so earlier positions are unchanged
+  for (auto p = tocPos_.rbegin(); p != tocPos_.rend() && text != ""; ++p) {
+    std::string text1 = text;
+
+    // TTY blocks separated by blank line (before following block if at start)
+    if (! emitter.isHtml()) {
+      if      ((*p).pos > 0)
+        text1 = "\n" + text;
+      else if (emitter.length() > 0)
+        text1 = text + "\n";
+    }
+
+    emitter.insert((*p).pos, text1);
+
+    auto pe = std::upper_bound(blockEnds_.begin(), blockEnds_.end(), (*p).pos);
+
+    for ( ; pe != blockEnds_.end(); ++pe)
+      *pe += text1.length();
+  }
+
+  // table of contents after last block is its own block
+  if (text != "" && (blockEnds_.empty() || blockEnds_.back() < emitter.length())) {
+    int line = tocPos_.back().line;
+
+    blockEnds_.push_back(emitter.length());
+    blockPos_ .push_back(linesSourcePos(line, line));
+  }
+
+  tocPos_.clear();
+
+  flushOutput(emitter);
+}
+
+// table of contents as converted markdown list of links (nested by heading level)
+std::string
+CMarkdown::
+tocText(Format format) const
+{
+  if (headings_.empty())
+    return "";
+
+  std::string str;
+
+  std::vector<int> levels; // levels of open lists
+
+  for (const auto &heading : headings_) {
+    while (! levels.empty() && levels.back() >= heading.level)
+      levels.pop_back();
+
+    str += std::string(2*int(levels.size()), ' ');
+
+    levels.push_back(heading.level);
+
+    str += "- [";
+
+    for (size_t i = 0; i < heading.text.size(); ++i) {
+      if (CMarkdownParse::isASCIIPunct(heading.text[i]))
+        str += '\\';
+
+      str += heading.text[i];
+    }
+
+    str += "](#" + heading.slug + ")\n";
+  }
+
+  CMarkdown markdown;
+
+  markdown.setTtyWidth(ttyWidth_);
+
+  return markdown.textToFormat(str, format);
+}
+
+void
+CMarkdown::
+addLink(const LinkRef &link)
+{
+  CMARKDOWN_TRACE_INSTANT("link", "addLink", link.ref + " " + link.dest);
+
+  links_[CMarkdownString::toLower(link.ref)] = link;
+}
+
+bool
+CMarkdown::
+getLink(const std::string &ref, LinkRef &link) const
+{
+  CMARKDOWN_TRACE_INSTANT("link", "getLink", ref);
+
+  if (statsEnabled_)
+    ++stats_.linkLookups;
+
+  std::string lref = CMarkdownString::toLower(ref);
+
+  auto p = links_.find(lref);
+
+  if (p != links_.end()) {
+    link = (*p).second;
+    return true;
+  }
+
+  // shared definitions
+  if (linkDict_ && linkDict_->getLink(lref, link))
+    return true;
+
+  return false;
+}
+
+bool
+CMarkdown::
+readLine(std::string &line)
+{
+  if (pos_ >= len_)
+    return false;
+
+  line = "";
+
+  while (pos_ < len_ && str_[pos_] != '\n')
+    line += str_[pos_++];
+
+  if (pos_ < len_ && str_[pos_] == '\n')
+    ++pos_;
+
+  return true;
+}
+
+//------
+
+bool
+CMarkdown::
+isSingleLineType(CMarkdownTagType type)
+{
+  const CMarkdownTagData &data = CMarkdown::getTagData(type);
+
+  return data.singleLine;
+}
+
+bool
+CMarkdown::
+isRecurseType(CMarkdownTagType type)
+{
+  const CMarkdownTagData &data = CMarkdown::getTagData(type);
+
+  return data.recurse;
+}
+
+std::string
+CMarkdown::
+typeColor(CMarkdownTagType type)
+{
+  const CMarkdownTagData &data = CMarkdown::getTagData(type);
+
+  return data.color;
+}
+
+void
+CMarkdown::
+setTypeColor(CMarkdownTagType type, const std::string &color)
+{
+  CMarkdownTagData &data = CMarkdown::getTagData(type);
+
+  data.color = color;
+}
+
+std::string
+CMarkdown::
+typeFont(CMarkdownTagType type)
+{
+  const CMarkdownTagData &data = CMarkdown::getTagData(type);
+
+  return data.font;
+}
+
+void
+CMarkdown::
+setTypeFont(CMarkdownTagType type, const std::string &font)
+{
+  CMarkdownTagData &data = CMarkdown::getTagData(type);
+
+  data.font = font;
+}
+
+CMarkdownTagType
+CMarkdown::
+stringToType(const std::string &str)
+{
+  std::string lstr = CMarkdownString::toLower(str);
+
+  const TagDatas &tagDatas = CMarkdown::getTagDatas();
+
+  for (const auto &p : tagDatas) {
+    const CMarkdownTagData &tagData = p.second;
+
+    if (tagData.name == lstr)
+      return tagData.type;
+  }
+
+  return CMarkdownTagType::NONE;
+}
+
+std::string
+CMarkdown::
+typeName(CMarkdownTagType type)
+{
+  const CMarkdownTagData &data = getTagData(type);
+
+  return data.name;
+}
+
+const char *
+CMarkdown::
+typeCName(CMarkdownTagType type)
+{
+  const CMarkdownTagData &data = getTagData(type);
+
+  return data.cname;
+}
+
+CMarkdownTagData &
+CMarkdown::
+getTagData(CMarkdownTagType type)
+{
+  TagDatas &tagDatas = getTagDatas();
+
+  auto p = tagDatas.find(type);
+  assert(p != tagDatas.end());
+
+  return (*p).second;
+}
+
+CMarkdown::TagDatas &
+CMarkdown::
+getTagDatas()
+{
+  static TagDatas tagDatas;
+
+  if (tagDatas.empty()) {
+    auto addTagData = [&](CMarkdownTagType type, const char *typeName,
+                          bool singleLine, bool recurse) {
+      CMarkdownTagData data(type, typeName);
+
+      data.singleLine = singleLine;
+      data.recurse    = recurse;
+
+      tagDatas[type] = data;
+    };
+
+    //---
+
+    //         type,                         name,         singleLine, recurse
+    addTagData(CMarkdownTagType::DOCUMENT  , "document"  , false     , true );
+    addTagData(CMarkdownTagType::P         , "p"         , true      , false);
+    addTagData(CMarkdownTagType::BLOCKQUOTE, "blockquote", false     , true );
+    addTagData(CMarkdownTagType::H1        , "h1"        , true      , false);
+    addTagData(CMarkdownTagType::H2        , "h2"        , true      , false);
+    addTagData(CMarkdownTagType::H3        , "h3"        , true      , false);
+    addTagData(CMarkdownTagType::H4        , "h4"        , true      , false);
+    addTagData(CMarkdownTagType::H5        , "h5"        , true      , false);
+    addTagData(CMarkdownTagType::H6        , "h6"        , true      , false);
+    addTagData(CMarkdownTagType::UL        , "ul"        , false     , false);
+    addTagData(CMarkdownTagType::OL        , "ol"        , false     , false);
+    addTagData(CMarkdownTagType::LI        , "li"        , true      , true );
+    addTagData(CMarkdownTagType::PRE       , "pre"       , false     , true );
+    addTagData(CMarkdownTagType::CODE      , "code"      , false     , false);
+    addTagData(CMarkdownTagType::TABLE     , "table"     , false     , true );
+    addTagData(CMarkdownTagType::TR        , "tr"        , false     , false);
+    addTagData(CMarkdownTagType::TD        , "td"        , false     , false);
+    addTagData(CMarkdownTagType::TH        , "th"        , false     , false);
+    addTagData(CMarkdownTagType::HR        , "hr"        , true      , false);
+    addTagData(CMarkdownTagType::EM        , "em"        , false     , false);
+    addTagData(CMarkdownTagType::STRONG    , "strong"    , false     , false);
+    addTagData(CMarkdownTagType::STRIKE    , "strike"    , false     , false);
+    addTagData(CMarkdownTagType::A         , "a"         , false     , false);
+  }
+
+  return tagDatas;
+}
+
+//------
+
+CMarkdownBlock::
+CMarkdownBlock(CMarkdown *markdown) :
+ markdown_(markdown), parent_(nullptr), type_(CMarkdownTagType::DOCUMENT)
+{
+}
+
+CMarkdownBlock::
+CMarkdownBlock(CMarkdownBlock *parent, CMarkdownTagType type) :
+ markdown_(nullptr), parent_(parent), type_(type)
+{
+}
+
+CMarkdownBlock::
+~CMarkdownBlock()
+{
+  for (auto &b : blocks_)
+    delete b;
+
+  // containers not yet processed
+  for (auto &l : lines_)
+    delete l.block;
+}
+
+void
+CMarkdownBlock::
+addBlock(CMarkdownBlock *block)
+{
+  blocks_.push_back(block);
+}
+
+// check for non-blank lines or containers
+bool
+CMarkdownBlock::
+hasContent() const
+{
+  for (const auto &line : lines_) {
+    if (line.block || ! line.line.empty())
+      return true;
+  }
+
+  return false;
+}
+
+void
+CMarkdownBlock::
+addLine(const Line &line)
+{
+  lines_.push_back(line);
+}
+
+void
+CMarkdownBlock::
 preProcess()
 {
-  currentLine_ = 0;
+  currentLine_ = 0;
+
+  while (currentLine_ < int(lines_.size())) {
+    // read line (tabs converted to 4 spaces)
+    LineData line1;
+
+    if (! getLine(line1))
+      break;
+
+    LinkRef linkRef;
+    int     istart, iend;
+
+    if (CMarkdownParse::isLinkReference(line1.line, linkRef, istart, iend)) {
+      markdown()->addLink(linkRef);
+    }
+  }
+}
+
+// process document lines returning output (output buffer handed off to caller
+// so no copy is kept by the blocks)
+std::string
+CMarkdownBlock::
+process(CMarkdown::Format format)
+{
+  // reserve output for input text plus markup
+  int len = 0;
+
+  for (const auto &line : lines_)
+    len += line.line.length() + 1;
+
+  CMarkdownEmitter emitter(format, len + len/2);
+
+  emitter.setWidth(markdown()->ttyWidth());
+
+  CMarkdown::Stats *stats = markdown()->statsData();
+
+  if (stats)
+    ++stats->allocations;
+
+  processBlocks(emitter);
+
+  // table of contents needs all headings
+  markdown()->fillToc(emitter);
+
+  // output not written to stream
+  if (stats)
+    stats->outputBytes += emitter.textBytes();
+
+  return emitter.takeText();
+}
+
+// parse lines into child blocks, each written to output as it completes
+void
+CMarkdownBlock::
+processBlocks(CMarkdownEmitter &emitter)
+{
+  PhaseScope scope(markdown(), CMarkdown::Phase::PARSE);
+
+  CMARKDOWN_TRACE_SCOPE("parse", CMarkdown::typeCName(type_), std::to_string(lines_.size()) + " lines");
+
+  currentLine_  = 0;
+
+  rootBlock_    = this;
+  currentBlock_ = rootBlock_;
+
+  processLines(emitter);
+
+  processed_ = true;
+}
+
+void
+CMarkdownBlock::
+processLines(CMarkdownEmitter &emitter)
+{
+  int       indent;
+  ATXData   atxData;
+  LinkRef   linkRef;
+  int       istart, iend;
+
+  while (currentLine_ < int(lines_.size())) {
+    // record end of output for previous top level block
+    if (! parent_) {
+      markdown()->addBlockEnd(emitter.length(), currentLine_);
+
+      // write completed blocks
+      markdown()->flushOutput(emitter);
+    }
+
+    // container parsed with this block's lines
+    if (lines_[currentLine_].block) {
+      flushBlocks();
+
+      CMarkdownBlock *block = lines_[currentLine_].block;
+
+      lines_[currentLine_++].block = nullptr;
+
+      addBlock(block);
+
+      block->toText(emitter);
+
+      continue;
+    }
+
+    // read line (tabs converted to 4 spaces)
+    LineData line1;
+
+    if (! getLine(line1))
+      break;
+
+    //---
+
+    CodeFence fence;
+
+    if      (CMarkdownParse::isBlankLine(line1.line)) {
+      endBlock();
+    }
+    else if (markdown()->isToc() && isTocLine(line1.line)) {
+      endBlock();
+
+      // filled when all headings are known
+      if (! markdown()->isSkipOutput())
+        markdown()->addToc(emitter.length(), lines_[currentLine_ - 1].src);
+    }
+    else if (isStartCodeFence(line1.line, fence)) {
+      flushBlocks();
+
+      CMarkdownBlock *block = startBlock(CMarkdownTagType::PRE);
+
+      // contents are the unprocessed lines up to the closing fence
+      CodeSpan code;
+
+      code.lines  = &lines_;
+      code.start  = currentLine_;
+      code.indent = line1.indent;
+
+      // language is first word of info string
+      int is = CMarkdownString::indexOf(fence.info, ' ');
+
+      code.lang = (is >= 0 ? fence.info.substr(0, size_t(is)) : fence.info);
+
+      int nl = int(lines_.size());
+
+      while (currentLine_ < nl && ! lines_[currentLine_].block &&
+             ! isEndCodeFence(lines_[currentLine_].line, fence))
+        ++currentLine_;
+
+      code.end = currentLine_;
+
+      // skip closing fence (nested container placeholder left for next loop)
+      if (currentLine_ < nl && ! lines_[currentLine_].block)
+        ++currentLine_;
+
+      block->setCode(code);
+
+      endBlock();
+
+      block->toText(emitter);
+    }
+    else if (CMarkdownParse::isRule(line1.line, istart, iend)) {
+      endBlock();
+
+      CMarkdownBlock *block = startBlock(CMarkdownTagType::HR);
+
+      endBlock();
+
+      block->toText(emitter);
+    }
+    else if (isHtmlLine(line1.line)) {
+      flushBlocks();
+
+      bool skip = markdown()->isSkipOutput();
+
+      if (! skip) {
+        emitter.raw(line1.line);
+        emitter.newline();
+      }
+
+      LineData line2;
+
+      while (getLine(line2)) {
+        if (CMarkdownParse::isBlankLine(line2.line))
+          break;
+
+        if (! skip) {
+          emitter.raw(line2.line);
+          emitter.newline();
+        }
+      }
+
+      if (! skip)
+        emitter.newline();
+      else
+        markdown()->setBlockSkipped();
+    }
+    else if (CMarkdownParse::isLinkReference(line1.line, linkRef, istart, iend)) {
+      endBlock();
+
+      int ind = CMarkdownString::indexOf(linkRef.dest, '#');
+
+      if      (ind == 0 && markdown()->isSkipOutput()) {
+        markdown()->setBlockSkipped();
+      }
+      else if (ind == 0) {
+        std::string ref1 = CMarkdownString::mid(linkRef.dest, 1);
+
+        // should match linkRef.ref ?
+        if (emitter.isHtml()) {
+          emitter.openTag("a");
+          emitter.attr("name", ref1);
+          emitter.endOpenTag();
+          emitter.closeTag("a");
+          emitter.newline();
+        }
+        else
+          emitter.text(ref1);
+      }
+
+      //markdown()->addLink(linkRef);
+    }
+    else if (! parent_ && isContainerLine(line1.line)) {
+      // block quotes and lists (nested containers parsed with them)
+      CMarkdownBlock *block = processContainers();
+
+      block->toText(emitter);
+    }
+    else if (CMarkdownParse::isATXHeader(line1.line, atxData, istart, iend)) {
+      endBlock();
+
+      CMarkdownBlock *block = startBlock(atxData.type);
+
+      addHeading(block, atxData.text, block->srcLine_);
+
+      addBlockLine(atxData.text);
+
+      endBlock();
+
+      block->toText(emitter);
+    }
+    else if (isIndentLine(line1.line, indent)) {
+      flushBlocks();
+
+      CMarkdownBlock *block = startBlock(CMarkdownTagType::PRE);
+
+      // contents are the unprocessed indented (or blank) lines with
+      // trailing blank lines left for the caller
+      CodeSpan code;
+
+      code.lines  = &lines_;
+      code.start  = currentLine_ - 1;
+      code.end    = currentLine_;
+      code.indent = 4;
+
+      int nl = int(lines_.size());
+
+      while (currentLine_ < nl && ! lines_[currentLine_].block) {
+        const std::string &str = lines_[currentLine_].line;
+
+        int i = 0;
+
+        int ns = CMarkdownParse::skipIndent(str, i);
+
+        if      (i >= int(str.size()))
+          ++currentLine_;
+        else if (ns >= 4)
+          code.end = ++currentLine_;
+        else
+          break;
+      }
+
+      currentLine_ = code.end;
+
+      block->setCode(code);
+
+      endBlock();
+
+      block->toText(emitter);
+    }
+    else if (isTableLine(line1.line)) {
+      CMarkdownBlock *block = startBlock(CMarkdownTagType::TABLE);
+
+      // contents are cell ranges of the unprocessed table lines
+      TableSpan table;
+
+      table.lines = &lines_;
+
+      addTableRow(table, currentLine_ - 1);
+
+      int nl = int(lines_.size());
+
+      while (currentLine_ < nl && ! lines_[currentLine_].block &&
+             isTableLine(lines_[currentLine_].line))
+        addTableRow(table, currentLine_++);
+
+      block->setTable(table);
+
+      endBlock();
+
+      block->toText(emitter);
+    }
+    else {
+      endBlock();
+
+      CMarkdownBlock *block = startBlock(CMarkdownTagType::P);
+
+      addBlockLine(line1.line, line1.brk);
+
+      int nl = 0;
+
+      LineData line2;
+
+      while (getLine(line2)) {
+        if (CMarkdownParse::isBlankLine(line2.line))
+          break;
+
+        CMarkdownTagType type;
+
+        if      (nl == 0 && isSetTextLine(line2.line, type)) {
+          endBlock(); // remove block
+
+          int i = 0;
+
+          CMarkdownParse::skipSpace(line1.line, i);
+
+          if (i > 0)
+            line1.line = CMarkdownString::mid(line1.line, i);
+
+          CMarkdownBlock *block = startBlock(type);
+
+          addHeading(block, line1.line, lines_[currentLine_ - 2].src);
+
+          addBlockLine(line1.line);
+
+          endBlock();
+
+          block->toText(emitter);
+
+          nl = -1;
+
+          break;
+        }
+        else if (isFormatLine(line2.line)) {
+          ungetLine();
+          break;
+        }
+
+        addBlockLine(CMarkdownString::mid(line2.line, line2.indent), line2.brk);
+
+        ++nl;
+      }
+
+      if (nl >= 0) {
+        endBlock();
+
+        block->toText(emitter);
+      }
+    }
+  }
+
+  endBlock();
+
+  if (! parent_) {
+    markdown()->addBlockEnd(emitter.length(), currentLine_);
+
+    markdown()->flushOutput(emitter);
+  }
+}
+
+// parse block quotes and lists starting at the current line in one pass using a
+// stack of open containers (block quotes and list items). Each line is matched
+// against the open containers, then new containers are started and the rest of
+// the line is added to the innermost container (or is a lazy continuation of its
+// paragraph). Containers nested in a block quote or list item are added to its
+// lines as placeholders so they are output in order when it is processed.
+//
+// Containers past the max nesting depth are not started (markers kept as text).
+CMarkdownBlock *
+CMarkdownBlock::
+processContainers()
+{
+  struct Container {
+    CMarkdownBlock *block  { nullptr }; // BLOCKQUOTE or LI block
+    int             indent { 0 };       // list item content indent
+    char            c      { '\0' };    // list item marker
+    bool            para   { false };   // last line is paragraph text
+    bool            fence  { false };   // in fenced code
+    CodeFence       codeFence;
+  };
+
+  using Containers = std::vector<Container>;
+
+  Containers stack;
+
+  CMarkdownBlock *top = nullptr; // top level container block
+
+  int maxNesting = markdown()->maxNesting();
+
+  auto closeContainers = [&](int n) {
+    while (int(stack.size()) > n) {
+      CMARKDOWN_TRACE_COMPLETE("block", CMarkdown::typeName(stack.back().block->blockType()),
+                               stack.back().block->traceStart_,
+                               "line " + std::to_string(stack.back().block->srcLine_ + 1));
+
+      stack.pop_back();
+    }
+  };
+
+  // add leaf line to container (line break kept as trailing spaces)
+  auto addContainerLine = [&](Container &c, const std::string &str, bool brk, int src) {
+    c.block->addLine(Line(brk ? str + "  " : str, false, src));
+
+    if      (c.fence) {
+      if (isEndCodeFence(str, c.codeFence))
+        c.fence = false;
+    }
+    else if (isStartCodeFence(str, c.codeFence)) {
+      c.fence = true;
+      c.para  = false;
+    }
+    else
+      c.para = (! CMarkdownParse::isBlankLine(str) && (c.para || ! isFormatLine(str)));
+  };
+
+  flushBlocks();
+
+  ungetLine(); // reread first line
+
+  LineData line;
+
+  while (getLine(line)) {
+    const std::string &str = line.line;
+
+    int len = str.length();
+    int src = lines_[currentLine_ - 1].src;
+
+    // match open containers (blank lines continue list items)
+    int i     = 0;
+    int depth = 0;
+
+    for ( ; depth < int(stack.size()); ++depth) {
+      const Container &c = stack[depth];
+
+      bool quote = (c.block->blockType() == CMarkdownTagType::BLOCKQUOTE);
+
+      // skip spaces up to quote marker or item indent (not whole indent so matching
+      // all containers is linear in line length)
+      int maxSpaces = (quote ? 4 : c.indent);
+
+      int j = i;
+
+      while (j < len && j - i < maxSpaces && CMarkdownString::isSpace(str[j]))
+        ++j;
+
+      int ns = j - i;
+
+      if (quote) {
+        if (ns >= 4 || j >= len || str[j] != '>')
+          break;
+
+        ++j;
+
+        if (j < len && str[j] == ' ')
+          ++j;
+
+        i = j;
+      }
+      else {
+        if (j < len && ns < c.indent)
+          break;
+
+        i = std::min(i + c.indent, len);
+      }
+    }
 
-  while (currentLine_ < int(lines_.size())) {
-    // read line (tabs converted to 4 spaces)
-    LineData line1;
+    bool matched = (depth == int(stack.size()));
+    bool fence   = (matched && ! stack.empty() && stack.back().fence);
 
-    if (! getLine(line1))
-      break;
+    // start new containers (not in fenced code)
+    bool started = false;
 
-    LinkRef linkRef;
-    int     istart, iend;
+    while (! fence && depth < maxNesting) {
+      // view of rest of line (no copy per container)
+      std::string_view rest = std::string_view(str).substr(std::min(i, len));
 
-    if (CMarkdownParse::isLinkReference(line1.line, linkRef, istart, iend)) {
-      markdown()->addLink(linkRef);
+      std::string_view quote;
+      ListData         list;
+      CMarkdownTagType listType = CMarkdownTagType::NONE;
+
+      bool isQuote = isBlockQuote(rest, quote);
+
+      if (! isQuote) {
+        if      (isUnorderedListLine(rest, list)) listType = CMarkdownTagType::UL;
+        else if (isOrderedListLine  (rest, list)) listType = CMarkdownTagType::OL;
+        else break;
+      }
+
+      // close unmatched containers (list item with same marker continues its list)
+      CMarkdownBlock *listBlock = nullptr;
+
+      if (depth < int(stack.size())) {
+        const Container &c = stack[depth];
+
+        if (listType != CMarkdownTagType::NONE && c.c == list.c &&
+            c.block->blockType() == CMarkdownTagType::LI &&
+            c.block->parent()->blockType() == listType)
+          listBlock = c.block->parent();
+
+        closeContainers(depth);
+      }
+
+      // new top level container ends this one
+      if (top && stack.empty() && ! listBlock) {
+        ungetLine();
+        return top;
+      }
+
+      // add container block to parent (placeholder line if in container)
+      auto addContainerBlock = [&](CMarkdownTagType type) {
+        CMarkdownBlock *parent = (! stack.empty() ? stack.back().block : currentBlock_);
+
+        CMarkdownBlock *block = createBlock(parent, type);
+
+        if (! stack.empty()) {
+          Line line1("", false, src);
+
+          line1.block = block;
+
+          parent->addLine(line1);
+
+          stack.back().para = false;
+        }
+        else {
+          parent->addBlock(block);
+
+          top = block;
+        }
+
+        return block;
+      };
+
+      Container c;
+
+      if (isQuote) {
+        c.block = addContainerBlock(CMarkdownTagType::BLOCKQUOTE);
+
+        i += rest.length() - quote.length();
+      }
+      else {
+        if (! listBlock)
+          listBlock = addContainerBlock(listType);
+
+        c.block  = createBlock(listBlock, CMarkdownTagType::LI);
+        c.indent = list.indent;
+        c.c      = list.c;
+
+        listBlock->addBlock(c.block);
+
+        i += list.indent;
+      }
+
+      stack.push_back(c);
+
+      ++depth;
+
+      started = true;
+    }
+
+    //---
+
+    if (! started && ! matched) {
+      // lazy continuation of paragraph text
+      if (stack.back().para && i < len) {
+        std::string rest = CMarkdownString::mid(str, i);
+
+        if (! isFormatLine(rest)) {
+          addContainerLine(stack.back(), rest, line.brk, src);
+          continue;
+        }
+      }
+
+      closeContainers(depth);
+
+      if (stack.empty()) {
+        ungetLine();
+        return top;
+      }
     }
+
+    addContainerLine(stack.back(), CMarkdownString::mid(str, std::min(i, len)), line.brk, src);
   }
+
+  closeContainers(0);
+
+  return top;
 }
 
-QString
+bool
 CMarkdownBlock::
-process(CMarkdown::Format format)
+isSetTextLine(const std::string &str, CMarkdownTagType &type) const
 {
-  if (! CMarkdown::isRecurseType(type_) || processed_)
-    return processedText_;
+  int i   = 0;
+  int len = str.length();
 
-  currentLine_  = 0;
+  // up to 3 spaces
+  if (CMarkdownParse::skipSpace(str, i) > 3)
+    return false;
 
-  rootBlock_    = this;
-  currentBlock_ = rootBlock_;
+  // followed by '=' or '-'
+  if (i >= len || (str[i] != '=' && str[i] != '-'))
+    return false;
 
-  processedText_ = processLines(format);
+  char c = str[i];
 
-  processed_ = true;
+  (void) CMarkdownParse::skipChar(str, i, c);
+
+  (void) CMarkdownParse::skipSpace(str, i);
+
+  // must be end of line
+  if (i < len)
+    return false;
+
+  type = (c == '=' ? CMarkdownTagType::H1 : CMarkdownTagType::H2);
 
-  return processedText_;
+  return true;
 }
 
-QString
+bool
 CMarkdownBlock::
-processLines(CMarkdown::Format format)
+isIndentLine(const std::string &str, int &n) const
 {
-  QString processedText = "";
+  int len = str.length();
 
-  int       indent;
-  ATXData   atxData;
-  LinkRef   linkRef;
-  QString   text;
-  ListData  list;
-  int       istart, iend;
+  int i = 0;
 
-  while (currentLine_ < int(lines_.size())) {
-    // read line (tabs converted to 4 spaces)
-    LineData line1;
+  n = CMarkdownParse::skipSpace(str, i);
 
-    if (! getLine(line1))
-      break;
+  if (n >= 4 && i != len)
+    return true;
 
-    if (markdown()->isDebug())
-      std::cerr << "DEBUG: Line: '" << line1.line.toStdString() << "'\n";
+  return false;
+}
 
-    //---
+bool
+CMarkdownBlock::
+isFormatLine(const std::string &str) const
+{
+  int len = str.length();
 
-    CodeFence fence;
+  int i = 0;
 
-    if      (CMarkdownParse::isBlankLine(line1.line)) {
-      endBlock();
-    }
-    else if (isStartCodeFence(line1.line, fence)) {
-      flushBlocks();
+  // skip space and detect indent line
+  if (CMarkdownParse::skipSpace(str, i) >= 4 && i != len)
+    return true;
 
-      CMarkdownBlock *block = startBlock(CMarkdownTagType::PRE);
+  // starts with format char
+  if (! isFormatChar(str, i))
+    return false;
 
-      startBlock(CMarkdownTagType::CODE);
+  // has any format chars
+  for ( ; i < len; ++i)
+    if (isFormatChar(str, i))
+      return true;
 
-      LineData line2;
+  return false;
+}
 
-      while (getLine(line2)) {
-        if (isEndCodeFence(line2.line, fence))
-          break;
+bool
+CMarkdownBlock::
+isFormatChar(const std::string &str, int i) const
+{
+  if (str[i] == '>') return true; // block quote
+  if (str[i] == '+') return true; // unordered list
+  if (str[i] == '-') return true; // unordered list
+  if (str[i] == '*') return true; // unordered list
+  if (str[i] == '#') return true; // header
+  if (str[i] == '|') return true; // table
 
-        addBlockLine(line2.line);
-      }
+  if (str[i] == '`' || str[i] == '~') { // code fence
+    int j = i;
 
-      endBlock();
-      endBlock();
+    char c = str[i];
 
-      processedText += block->toText(format);
-    }
-    else if (CMarkdownParse::isRule(line1.line, istart, iend)) {
-      endBlock();
+    if (CMarkdownParse::skipChar(str, j, c) >= 3)
+      return true;
+  }
 
-      CMarkdownBlock *block = startBlock(CMarkdownTagType::HR);
+  int len = str.length();
 
-      endBlock();
+  if (i < len && CMarkdownString::isDigit(str[i])) {
+    int j = i + 1;
 
-      processedText += block->toText(format);
-    }
-    else if (isHtmlLine(line1.line)) {
-      flushBlocks();
+    while (j < len && CMarkdownString::isDigit(str[j]))
+      ++j;
 
-      processedText += line1.line + "\n";
+    if (j < len && (str[j] == '.' || str[j] == ')')) // ordered list
+      return true;
+  }
 
-      LineData line2;
+  return false;
+}
 
-      while (getLine(line2)) {
-        if (CMarkdownParse::isBlankLine(line2.line))
-          break;
+bool
+CMarkdownBlock::
+isStartCodeFence(const std::string &str, CodeFence &fence) const
+{
+  return CMarkdownParse::isStartCodeFence(str, fence);
+}
 
-        processedText += line2.line + "\n";
-      }
+bool
+CMarkdownBlock::
+isEndCodeFence(const std::string &str, const CodeFence &fence) const
+{
+  return CMarkdownParse::isEndCodeFence(str, fence);
+}
+
+bool
+CMarkdownBlock::
+isHtmlLine(const std::string &str) const
+{
+  using NameSet = std::set<std::string>;
+
+  NameSet nameSet;
+
+  if (nameSet.empty()) {
+    std::vector<std::string> names = {{
+      "article", "header", "aside", "hgroup", "blockquote", "hr", "iframe", "img", "body",
+      "map", "button", "object", "canvas", "caption", "output", "col", "p", "colgroup",
+      "pre", "dd", "progress", "div", "section", "dl", "table", "td", "dt", "tbody",
+      "embed", "textarea", "fieldset", "tfoot", "figcaption", "th", "figure", "thead",
+      "footer", "tr", "form", "h1", "h2", "h3", "h4", "h5", "h6", "ol", "ul", "li",
+      "video", "script", "style" }};
+
+    for (const auto &name : names)
+      nameSet.insert(name);
+  }
+
+  int len = str.length();
+
+  int i = 0;
+
+  if (CMarkdownParse::skipSpace(str, i) > 3)
+    return false;
+
+  if (i >= len)
+    return false;
+
+  if (str[i] != '<')
+    return false;
+
+  ++i;
+
+  std::string name;
+
+  while (i < len && CMarkdownString::isAlpha(str[i]))
+    name += str[i++];
+
+  std::string lname = CMarkdownString::toLower(name);
+
+  auto p = nameSet.find(lname);
+
+  return (p != nameSet.end());
+}
+
+bool
+CMarkdownBlock::
+isBlockQuote(std::string_view str, std::string_view &quote) const
+{
+  return CMarkdownParse::isBlockQuote(str, quote);
+}
+
+bool
+CMarkdownBlock::
+isContainerLine(const std::string &str) const
+{
+  std::string_view quote;
+  ListData         list;
+
+  return (isBlockQuote(str, quote) || isUnorderedListLine(str, list) ||
+          isOrderedListLine(str, list));
+}
+
+bool
+CMarkdownBlock::
+isUnorderedListLine(std::string_view str, ListData &list) const
+{
+  return CMarkdownParse::isUnorderedListLine(str, list);
+}
+
+bool
+CMarkdownBlock::
+isOrderedListLine(std::string_view str, ListData &list) const
+{
+  return CMarkdownParse::isOrderedListLine(str, list);
+}
+
+bool
+CMarkdownBlock::
+isTableLine(const std::string &str) const
+{
+  return CMarkdownParse::isTableLine(str);
+}
+
+// check for table of contents placeholder line ("[TOC]")
+bool
+CMarkdownBlock::
+isTocLine(const std::string &str) const
+{
+  int i = 0;
+
+  if (CMarkdownParse::skipSpace(str, i) >= 4)
+    return false;
+
+  return (CMarkdownString::trimmed(CMarkdownString::mid(str, i)) == "[TOC]");
+}
+
+// add heading block to document heading index (slug used as block id)
+void
+CMarkdownBlock::
+addHeading(CMarkdownBlock *block, const std::string &text, int src)
+{
+  int level = int(block->type_) - int(CMarkdownTagType::H1) + 1;
+
+  block->id_ = markdown()->addHeading(level, text, src);
+}
 
-      processedText += "\n";
-    }
-    else if (CMarkdownParse::isLinkReference(line1.line, linkRef, istart, iend)) {
-      endBlock();
+// add cell ranges of table line to table. A second line of only delimiter
+// cells (e.g. ':---:') with the same number of cells makes the first row the
+// header and sets the column alignments.
+void
+CMarkdownBlock::
+addTableRow(TableSpan &table, int line) const
+{
+  const std::string &str = (*table.lines)[line].line;
 
-      int ind = linkRef.dest.indexOf("#");
+  int len = str.length();
 
-      if (ind == 0) {
-        QString ref1 = linkRef.dest.mid(1);
+  int i = 0;
 
-        // should match linkRef.ref ?
-        if (format == CMarkdown::Format::HTML)
-          processedText += QString("<a name=\"%1\"></a>\n").arg(ref1);
-        else
-          processedText += ref1;
-      }
+  CMarkdownParse::skipSpace(str, i);
 
-      //markdown()->addLink(linkRef);
-    }
-    else if (isUnorderedListLine(line1.line, list)) {
-      endBlock();
+  assert(i < len && str[i] == '|');
 
-      processedText += processList(CMarkdownTagType::UL, list, format);
-    }
-    else if (isOrderedListLine(line1.line, list)) {
-      endBlock();
+  ++i;
 
-      processedText += processList(CMarkdownTagType::OL, list, format);
-    }
-    else if (CMarkdownParse::isATXHeader(line1.line, atxData, istart, iend)) {
-      endBlock();
+  TableSpan::Row row;
 
-      CMarkdownBlock *block = startBlock(atxData.type);
+  row.line = line;
+  row.cell = int(table.cells.size());
 
-      addBlockLine(atxData.text);
+  // split at unescaped '|' (text after last '|' is a cell if not blank)
+  while (i < len) {
+    int i1 = i;
 
-      endBlock();
+    while (i < len && str[i] != '|') {
+      if (str[i] == '\\' && i < len - 1)
+        ++i;
 
-      processedText += block->toText(format);
+      ++i;
     }
-    else if (isIndentLine(line1.line, indent)) {
-      flushBlocks();
 
-      CMarkdownBlock *block = startBlock(CMarkdownTagType::PRE);
+    int i2 = i;
 
-      startBlock(CMarkdownTagType::CODE);
+    while (i1 < i2 && CMarkdownString::isSpace(str[i1    ])) ++i1;
+    while (i2 > i1 && CMarkdownString::isSpace(str[i2 - 1])) --i2;
 
-      addBlockLine(line1.line.mid(indent));
+    if (i >= len && i1 == i2)
+      break;
 
-      LineData line2;
+    TableSpan::Cell cell;
 
-      while (getLine(line2)) {
-        if      (isIndentLine(line2.line, indent))
-          addBlockLine(line2.line.mid(indent));
-        else if (CMarkdownParse::isBlankLine(line2.line))
-          addBlockLine(line2.line);
-        else {
-          ungetLine();
-          break;
-        }
-      }
+    cell.start = i1;
+    cell.len   = i2 - i1;
 
-      endBlock();
-      endBlock();
+    table.cells.push_back(cell);
 
-      processedText += block->toText(format);
-    }
-    else if (isBlockQuote(line1.line, text)) {
-      CMarkdownBlock *block = startBlock(CMarkdownTagType::BLOCKQUOTE);
+    ++row.ncell;
 
-      addBlockLine(text);
+    ++i; // skip '|'
+  }
 
-      LineData line2;
+  if (row.ncell == 0)
+    return;
 
-      QString quote1;
+  //---
 
-      while (getLine(line2)) {
-        if      (isContinuationLine(line2.line)) {
-          appendBlockLine(line2.line);
-        }
-        else if (isBlockQuote(line2.line, quote1)) {
-          addBlockLine(quote1);
-        }
-        else {
-          ungetLine();
-          break;
-        }
-      }
+  // check for delimiter row after first row
+  if (table.rows.size() == 1 && ! table.header && row.ncell == table.rows[0].ncell) {
+    TableSpan::Aligns aligns;
 
-      endBlock();
+    for (int c = 0; c < row.ncell; ++c) {
+      const TableSpan::Cell &cell = table.cells[row.cell + c];
 
-      processedText += block->toText(format);
-    }
-    else if (isTableLine(line1.line)) {
-      CMarkdownBlock *block = startBlock(CMarkdownTagType::TABLE);
+      int i1 = cell.start, i2 = cell.start + cell.len;
 
-      parseTableLine(line1.line);
+      bool lcolon = (i1 < i2 && str[i1] == ':');
+      bool rcolon = (i2 > i1 + 1 && str[i2 - 1] == ':');
 
-      LineData line2;
+      if (lcolon) ++i1;
+      if (rcolon) --i2;
 
-      while (getLine(line2)) {
-        if (isTableLine(line2.line))
-          parseTableLine(line2.line);
-        else {
-          ungetLine();
-          break;
-        }
+      int nd = 0;
+
+      while (i1 < i2 && str[i1] == '-') {
+        ++i1; ++nd;
       }
 
-      endBlock();
+      if (nd == 0 || i1 < i2)
+        break;
 
-      processedText += block->toText(format);
+      if      (lcolon && rcolon) aligns.push_back(CMarkdown::Align::CENTER);
+      else if (lcolon          ) aligns.push_back(CMarkdown::Align::LEFT  );
+      else if (rcolon          ) aligns.push_back(CMarkdown::Align::RIGHT );
+      else                       aligns.push_back(CMarkdown::Align::NONE  );
     }
-    else {
-      endBlock();
-
-      CMarkdownBlock *block = startBlock(CMarkdownTagType::P);
-
-      addBlockLine(line1.line, line1.brk);
-
-      int nl = 0;
-
-      LineData line2;
-
-      while (getLine(line2)) {
-        if (CMarkdownParse::isBlankLine(line2.line))
-          break;
 
-        CMarkdownTagType type;
+    if (int(aligns.size()) == row.ncell) {
+      table.cells.resize(row.cell);
 
-        if      (nl == 0 && isSetTextLine(line2.line, type)) {
-          endBlock(); // remove block
+      table.header  = true;
+      table.aligns  = aligns;
+      table.columns = row.ncell;
 
-          int i = 0;
+      return;
+    }
+  }
 
-          CMarkdownParse::skipSpace(line1.line, i);
+  table.rows.push_back(row);
 
-          if (i > 0)
-            line1.line = line1.line.mid(i);
+  // header row defines columns (extra cells ignored)
+  if (! table.header)
+    table.columns = std::max(table.columns, row.ncell);
+}
 
-          CMarkdownBlock *block = startBlock(type);
+void
+CMarkdownBlock::
+replaceEmbeddedStyles(const std::string &str, bool code, CMarkdownEmitter &emitter) const
+{
+  PhaseScope scope(markdown(), CMarkdown::Phase::INLINE);
 
-          addBlockLine(line1.line);
+  int i   = 0;
+  int len = str.length();
 
-          endBlock();
+  while (i < len) {
+    // escape
+    if      (i < len - 1 && str[i] == '\\' && CMarkdownParse::isASCIIPunct(str[i + 1])) {
+      ++i;
 
-          processedText += block->toText(format);
+      emitter.text(str[i++]);
+    }
+    // emphasis
+    else if (! code && (str[i] == '*' || str[i] == '_')) {
+      std::string str2;
+      int         start2;
 
-          nl = -1;
+      int nc = CMarkdownParse::parseSurroundText(str, i, str2, start2);
 
-          break;
-        }
-        else if (isFormatLine(line2.line)) {
-          ungetLine();
-          break;
-        }
+      if (nc > 0) {
+        if (nc == 1)
+          emphasisText(str2, emitter);
+        else
+          boldText(str2, emitter);
+      }
+      else {
+        emitter.text(str[i++]);
+      }
+    }
+    // strike
+    else if (! code && (i < len - 1 && str[i] == '~' && str[i + 1] == '~')) {
+      std::string str2;
+      int         start2;
 
-        addBlockLine(line2.line.mid(line2.indent), line2.brk);
+      int nc = CMarkdownParse::parseSurroundText(str, i, str2, start2);
 
-        ++nl;
+      if (nc > 1) {
+        strikeText(str2, emitter);
+      }
+      else {
+        emitter.text(str[i++]);
+        emitter.text(str[i++]);
       }
+    }
+    // code
+    else if (! code && (str[i] == '`')) {
+      std::string str2;
+      int         start2;
 
-      if (nl >= 0) {
-        endBlock();
+      int nc = CMarkdownParse::parseSurroundText(str, i, str2, start2);
 
-        processedText += block->toText(format);
+      if (nc > 0) {
+        codeText(str2, emitter);
+      }
+      else {
+        emitter.text(str[i++]);
       }
     }
-  }
+    // image link
+    else if (! code && (i < len - 1 && str[i] == '!' && str[i + 1] == '[')) {
+      int i1 = i;
 
-  endBlock();
+      i += 2;
 
-  return processedText;
-}
+      std::string str2;
 
-QString
-CMarkdownBlock::
-processList(CMarkdownTagType type, const ListData &list, CMarkdown::Format format)
-{
-  QString res;
+      while (i < len && str[i] != ']')
+        str2 += str[i++];
 
-  CMarkdownBlock *block = startBlock(type);
+      if (i < len && str[i] == ']') {
+        ++i;
 
-  startBlock(CMarkdownTagType::LI);
+        std::string str3, str4;
 
-  addBlockLine(list.text);
+        if      (i < len && str[i] == '(') {
+          ++i;
 
-  int numBlankLines = 0;
+          while (i < len && str[i] != ')') {
+            if (str[i] == '\"')
+              break;
 
-  LineData line2;
+            str3 += str[i++];
+          }
 
-  while (getLine(line2)) {
-    ListData list1;
+          if (i < len && str[i] == '\"') {
+            ++i;
 
-    if      (isUnorderedListLine(line2.line, list1)) {
-      if (type == CMarkdownTagType::UL) {
-        if (numBlankLines > 0) {
-          // add empty list item
-          endBlock(); // LI
+            while (i < len && str[i] != ')') {
+              if (str[i] == '\"')
+                break;
 
-          startBlock(CMarkdownTagType::LI);
-        }
+              str4 += str[i++];
+            }
+          }
 
-        if (list1.indent >= list.indent && list1.c == list.c) {
-          // start child list if indent 2 or more greater
-          if (list1.indent >= list.indent + 2) {
-            endBlock(); // LI
+          while (i < len && str[i] != ')')
+            ++i;
 
-            processList(CMarkdownTagType::UL, list1, format);
+          if (i < len && str[i] == ')') {
+            ++i;
 
-            startBlock(CMarkdownTagType::LI);
+            str3 = CMarkdownString::simplified(str3);
 
-            numBlankLines = 0;
+            imageText(imageSrc(str3), str4, str2, emitter);
           }
           else {
-            endBlock(); // LI
-
-            startBlock(CMarkdownTagType::LI);
+            i = i1;
 
-            addBlockLine(list1.text);
+            emitter.text(str[i++]);
           }
         }
-        else {
-          ungetLine();
-          break;
-        }
+        else if (i < len && str[i] == '[') {
+          ++i;
 
-        numBlankLines = 0;
-      }
-      else {
-        if (list1.indent >= list.indent) {
-          endBlock(); // LI
+          while (i < len && str[i] != ']')
+            str3 += str[i++];
 
-          processList(CMarkdownTagType::UL, list1, format);
+          if (i < len && str[i] == ']') {
+            ++i;
 
-          startBlock(CMarkdownTagType::LI);
+            imageText(imageSrc(str3), "", str2, emitter);
+          }
+          else {
+            i = i1;
 
-          numBlankLines = 0;
+            emitter.text(str[i++]);
+          }
         }
         else {
-          ungetLine();
-          break;
+          LinkRef ref;
+
+          if (markdown()->getLink(str2, ref)) {
+            imageText(imageSrc(ref.dest), ref.title, ref.ref, emitter);
+          }
+          else {
+            i = i1;
+
+            emitter.text(str[i++]);
+          }
         }
       }
+      else {
+        i = i1;
+
+        emitter.text(str[i++]);
+      }
     }
-    else if (isOrderedListLine(line2.line, list1)) {
-      if (type == CMarkdownTagType::OL) {
-        if (numBlankLines > 0) {
-          // add empty list item
-          endBlock(); // LI
+    // link
+    else if (! code && str[i] == '[') {
+      int i1 = i;
 
-          startBlock(CMarkdownTagType::LI);
-        }
+      ++i;
+
+      // link text
+      std::string str2;
 
-        if (list1.indent >= list.indent && list1.c == list.c) {
-          // start child list if indent 2 or more greater
-          if (list1.indent >= list.indent + 2) {
-            endBlock(); // LI
+      while (i < len && str[i] != ']')
+        str2 += str[i++];
+
+      if (i < len && str[i] == ']') {
+        ++i;
+
+        std::string str3;
+
+        // '(' href "title" ')'
+        if      (i < len && str[i] == '(') {
+          ++i;
+
+          while (i < len && str[i] != ')')
+            str3 += str[i++];
+
+          if (i < len && str[i] == ')') {
+            ++i;
 
-            processList(CMarkdownTagType::OL, list1, format);
+            // split into href and title
+            std::string href, title;
 
-            startBlock(CMarkdownTagType::LI);
+            splitLinkRef(str3, href, title);
 
-            numBlankLines = 0;
+            anchorText(href, title, str2, emitter);
           }
-          // start new list item
           else {
-            endBlock(); // LI
+            i = i1;
+
+            emitter.text(str[i++]);
+          }
+        }
+        // '[' href ']'
+        else if (i < len && str[i] == '[') {
+          ++i;
+
+          while (i < len && str[i] != ']')
+            str3 += str[i++];
+
+          if (i < len && str[i] == ']') {
+            ++i;
+
+            LinkRef ref;
 
-            startBlock(CMarkdownTagType::LI);
+            if (markdown()->getLink(str3, ref))
+              anchorText(ref.dest, ref.title, str2, emitter);
+            else
+              anchorText(str3, "", str2, emitter);
+          }
+          else {
+            i = i1;
 
-            addBlockLine(list1.text);
+            emitter.text(str[i++]);
           }
         }
+        // no href so lookup
         else {
-          ungetLine();
-          break;
+          LinkRef ref;
+
+          if (markdown()->getLink(str2, ref))
+            anchorText(ref.dest, ref.title, ref.ref, emitter);
+          else {
+            i = i1;
+
+            emitter.text(str[i++]);
+          }
         }
-
-        numBlankLines = 0;
       }
       else {
-        if (list1.indent >= list.indent) {
-          endBlock(); // LI
-
-          processList(CMarkdownTagType::OL, list1, format);
-
-          startBlock(CMarkdownTagType::LI);
+        i = i1;
 
-          numBlankLines = 0;
-        }
-        else {
-          ungetLine();
-          break;
-        }
+        emitter.text(str[i++]);
       }
     }
-    else if (CMarkdownParse::isBlankLine(line2.line)) {
-      ++numBlankLines;
+    // TODO: auto links
 
-      if (numBlankLines > 1)
-        break;
-    }
-    else if (line2.indent >= list.indent) {
-      if (numBlankLines > 0) {
-        addBlockLine("");
-      }
+    // escape special chars
+    else if (str[i] == '<') {
+      std::string ref;
 
-      if (line2.brk)
-        addBlockLine(line2.line.mid(list.indent) + "  ");
+      if (isAutoLink(str, i, ref))
+        anchorText(ref, "", ref, emitter);
       else
-        addBlockLine(line2.line.mid(list.indent));
-
-      numBlankLines = 0;
+        emitter.text(str[i++]);
     }
-    else {
-      ungetLine();
-      break;
+    // hard line break
+    else if (str[i] == '\t') {
+      emitter.lineBreak(); ++i;
     }
-  }
-
-  endBlock(); // LI
-  endBlock(); // UL, OL
+    // plain text up to next inline construct
+    else {
+      int i1 = i++;
 
-  res += block->toText(format);
+      while (i < len && ! isInlineChar(str[i], code))
+        ++i;
 
-  return res;
+      emitter.text(str.data() + i1, i - i1);
+    }
+  }
 }
 
-bool
+std::string
 CMarkdownBlock::
-isContinuationLine(const QString &str) const
+imageSrc(const std::string &filename) const
 {
-  int len = str.length();
-
-  if (len == 0 || CMarkdownParse::isASCIIPunct(str[0]))
-    return false;
-
-  return true;
+  return CMarkdownEmitter::fileUrl(filename);
 }
 
-bool
+void
 CMarkdownBlock::
-isSetTextLine(const QString &str, CMarkdownTagType &type) const
+splitLinkRef(const std::string &str, std::string &href, std::string &title) const
 {
   int i   = 0;
-  int len = str.length();
+  int len = str.size();
 
-  // up to 3 spaces
-  if (CMarkdownParse::skipSpace(str, i) > 3)
-    return false;
+  href = "";
 
-  // followed by '=' or '-'
-  if (i >= len || (str[i] != '=' && str[i] != '-'))
-    return false;
+  while (i < len && ! CMarkdownString::isSpace(str[i])) {
+    href += str[i++];
+  }
 
-  QChar c = str[i];
+  CMarkdownParse::skipSpace(str, i);
 
-  (void) CMarkdownParse::skipChar(str, i, c);
+  // check for title
+  title = "";
 
-  (void) CMarkdownParse::skipSpace(str, i);
+  if (i < len && (str[i] == '"' || str[i] == '\'')) {
+    char c = str[i++];
 
-  // must be end of line
-  if (i < len)
-    return false;
+    while (i < len && str[i] != c)
+      title += str[i++];
 
-  type = (c == '=' ? CMarkdownTagType::H1 : CMarkdownTagType::H2);
+    if (str[i] == c) {
+      ++i;
+    }
+  }
 
-  return true;
+  // TODO: error handling
+}
+
+std::string
+CMarkdownBlock::
+replaceHtmlChars(const std::string &str) const
+{
+  return CMarkdownEmitter::escapeString(str);
 }
 
 bool
 CMarkdownBlock::
-isIndentLine(const QString &str, int &n) const
+isAutoLink(const std::string &str, int &i, std::string &ref) const
 {
+  int i1 = i;
+
   int len = str.length();
 
-  int i = 0;
+  if (i1 >= len || str[i1] != '<')
+    return false;
 
-  n = CMarkdownParse::skipSpace(str, i);
+  CMarkdownParse::skipSpace(str, i1);
 
-  if (n >= 4 && i != len)
-    return true;
+  ++i1;
 
-  return false;
-}
+  std::string scheme;
 
-bool
-CMarkdownBlock::
-isFormatLine(const QString &str) const
-{
-  int len = str.length();
+  while (i1 < len && ! CMarkdownString::isSpace(str[i1]) && str[i1] != ':') {
+    if (! CMarkdownString::isAlpha(str[i1]))
+      return false;
 
-  int i = 0;
+    scheme += str[i1++];
+  }
 
-  // skip space and detect indent line
-  if (CMarkdownParse::skipSpace(str, i) >= 4 && i != len)
-    return true;
+  CMarkdownParse::skipSpace(str, i1);
 
-  // starts with format char
-  if (! isFormatChar(str, i))
+  if (i1 >= len || str[i1] != ':')
     return false;
 
-  // has any format chars
-  for ( ; i < len; ++i)
-    if (isFormatChar(str, i))
-      return true;
-
-  return false;
-}
+  ++i1;
 
-bool
-CMarkdownBlock::
-isFormatChar(const QString &str, int i) const
-{
-  if (str[i] == '>') return true; // block quote
-  if (str[i] == '+') return true; // unordered list
-  if (str[i] == '-') return true; // unordered list
-  if (str[i] == '*') return true; // unordered list
-  if (str[i] == '#') return true; // header
-  if (str[i] == '|') return true; // table
+  CMarkdownParse::skipSpace(str, i1);
 
-  if (str[i] == '`' || str[i] == '~') { // code fence
-    int j = i;
+  std::string ref1;
 
-    QChar c = str[i];
+  while (i1 < len && str[i1] != '>')
+    ref1 += str[i1++];
 
-    if (CMarkdownParse::skipChar(str, j, c) >= 3)
-      return true;
-  }
+  if (i1 >= len || str[i1] != '>')
+    return false;
 
-  int len = str.length();
+  ++i1;
 
-  if (i < len && str[i].isDigit()) {
-    int j = i + 1;
+  ref = scheme + ":" + ref1;
 
-    while (j < len && str[j].isDigit())
-      ++j;
+  //ref = CMarkdownString::mid(str, i + 1, i1 - i - 2);
 
-    if (j < len && (str[j] == '.' || str[j] == ')')) // ordered list
-      return true;
-  }
+  i = i1;
 
-  return false;
+  return true;
 }
 
 bool
 CMarkdownBlock::
-isStartCodeFence(const QString &str, CodeFence &fence) const
+getLine(LineData &line)
 {
-  int len = str.length();
-
-  int i = 0;
+  line.brk = false;
 
-  if (CMarkdownParse::skipSpace(str, i) > 3)
+  // stop at end or container (output by caller)
+  if (currentLine_ >= int(lines_.size()) || lines_[currentLine_].block)
     return false;
 
-  if (i >= len)
-    return false;
+  std::string str = lines_[currentLine_++].line;
 
-  fence.c = str[i++];
+  std::string spaces;
+  int         ns = 0;
 
-  if (fence.c != '`' && fence.c != '~')
-    return false;
+  int len = str.size();
 
-  fence.n = CMarkdownParse::skipChar(str, i, fence.c) + 1;
+  int i = 0;
 
-  if (fence.n < 3)
-    return false;
+  line.line  = "";
+  line.blank = true;
 
-  CMarkdownParse::skipSpace(str, i);
+  while (i < len && str[i] != '\n') {
+    if (CMarkdownString::isSpace(str[i])) {
+      // expand tabs
+      if (str[i] == '\t')
+        spaces += "    ";
+      else
+        spaces += " ";
 
-  fence.info = "";
+      ++ns;
+      ++i;
+    }
+    else {
+      line.line += spaces;
 
-  while (i < len) {
-    if (str[i] == '`')
-      return false;
+      spaces = "";
+      ns     = 0;
 
-    fence.info += str[i++];
+      line.blank = false;
+
+      line.line += str[i++];
+    }
   }
 
-  fence.info = fence.info.simplified();
+  if (ns >= 2)
+    line.brk = true;
+
+  line.indent = 0;
+
+  CMarkdownParse::skipSpace(line.line, line.indent);
 
   return true;
 }
 
-bool
+void
 CMarkdownBlock::
-isEndCodeFence(const QString &str, const CodeFence &fence) const
+ungetLine()
 {
-  int len = str.length();
-
-  int i = 0;
-
-  if (CMarkdownParse::skipSpace(str, i) > 3)
-    return false;
+  assert(currentLine_ > 0);
 
-  if (i >= len)
-    return false;
+  --currentLine_;
+}
 
-  if (str[i] != fence.c)
-    return false;
+CMarkdownBlock *
+CMarkdownBlock::
+startBlock(CMarkdownTagType type)
+{
+  CMarkdownBlock *block = createBlock(currentBlock_, type);
 
-  ++i;
+  currentBlock_->addBlock(block);
 
-  if (CMarkdownParse::skipChar(str, i, fence.c) < fence.n - 1)
-    return false;
+  currentBlock_ = block;
 
-  return true;
+  return block;
 }
 
-bool
+// create block for current line (not added to parent)
+CMarkdownBlock *
 CMarkdownBlock::
-isHtmlLine(const QString &str) const
+createBlock(CMarkdownBlock *parent, CMarkdownTagType type)
 {
-  using NameSet = std::set<QString>;
-
-  NameSet nameSet;
+  CMarkdownBlock *block = new CMarkdownBlock(parent, type);
 
-  if (nameSet.empty()) {
-    std::vector<QString> names = {{
-      "article", "header", "aside", "hgroup", "blockquote", "hr", "iframe", "img", "body",
-      "map", "button", "object", "canvas", "caption", "output", "col", "p", "colgroup",
-      "pre", "dd", "progress", "div", "section", "dl", "table", "td", "dt", "tbody",
-      "embed", "textarea", "fieldset", "tfoot", "figcaption", "th", "figure", "thead",
-      "footer", "tr", "form", "h1", "h2", "h3", "h4", "h5", "h6", "ol", "ul", "li",
-      "video", "script", "style" }};
+  CMarkdown::Stats *stats = markdown()->statsData();
 
-    for (const auto &name : names)
-      nameSet.insert(name);
+  if (stats) {
+    ++stats->blocks[type];
+    ++stats->allocations;
   }
 
-  int len = str.length();
-
-  int i = 0;
-
-  if (CMarkdownParse::skipSpace(str, i) > 3)
-    return false;
-
-  if (i >= len)
-    return false;
-
-  if (str[i] != '<')
-    return false;
-
-  ++i;
-
-  QString name;
+  // source line of current line
+  if (currentLine_ > 0 && currentLine_ <= int(lines_.size()))
+    block->srcLine_ = lines_[currentLine_ - 1].src;
 
-  while (i < len && str[i].isLetter())
-    name += str[i++];
-
-  QString lname = name.toLower();
-
-  auto p = nameSet.find(lname);
+  block->traceStart_ = CMARKDOWN_TRACE_NOW();
 
-  return (p != nameSet.end());
+  return block;
 }
 
-bool
+void
 CMarkdownBlock::
-isBlockQuote(const QString &str, QString &quote) const
+addBlockLine(const std::string &line, bool brk)
 {
-  int len = str.length();
-
-  int i = 0;
-
-  if (CMarkdownParse::skipSpace(str, i) >= 4)
-    return false;
+  int src = (currentLine_ > 0 && currentLine_ <= int(lines_.size()) ?
+             lines_[currentLine_ - 1].src : -1);
 
-  if (i >= len || str[i] != '>')
-    return false;
+  currentBlock_->addLine(Line(line, brk, src));
 
-  ++i;
+  CMarkdown::Stats *stats = markdown()->statsData();
 
-  if (i < len && str[i].isSpace())
-    quote = str.mid(i + 1);
-  else
-    quote = str.mid(i);
+  if (stats)
+    ++stats->allocations;
+}
 
-  return true;
+void
+CMarkdownBlock::
+flushBlocks()
+{
+  while (currentBlock_ != rootBlock_)
+    endBlock();
 }
 
-bool
+CMarkdownBlock *
 CMarkdownBlock::
-isUnorderedListLine(const QString &str, ListData &list) const
+endBlock()
 {
-  int len = str.length();
-
-  int i = 0;
+  if (currentBlock_ == rootBlock_)
+    return nullptr;
 
-  if (CMarkdownParse::skipSpace(str, i) >= 4)
-    return false;
+  // block parse range (start to end line)
+  CMARKDOWN_TRACE_COMPLETE("block", CMarkdown::typeName(currentBlock_->blockType()),
+                           currentBlock_->traceStart_,
+                           "line " + std::to_string(currentBlock_->srcLine_ + 1));
 
-  if (i >= len - 1)
-    return false;
+  currentBlock_ = currentBlock_->parent();
 
-  if (str[i] != '-' && str[i] != '+' && str[i] != '*')
-    return false;
+  return currentBlock_;
+}
 
-  list.c = str[i];
+void
+CMarkdownBlock::
+print(int depth) const
+{
+  std::string tag = CMarkdown::typeName(type_);
 
-  ++i;
+  for (int i = 0; i < depth; ++i)
+    std::cerr << "  ";
 
-  if (! str[i].isSpace())
-    return false;
+  std::cerr << "-> " << tag << "\n";
 
-  ++i;
+  for (auto &l : lines_) {
+    for (int i = 0; i < depth; ++i)
+      std::cerr << "  ";
 
-  CMarkdownParse::skipSpace(str, i);
+    std::cerr << "  \"" << l.line << "\"\n";
+  }
 
-  list.indent = i;
+  if (table_.lines) {
+    for (const auto &row : table_.rows) {
+      for (int i = 0; i < depth; ++i)
+        std::cerr << "  ";
 
-  list.text = str.mid(i);
+      std::cerr << "  \"" << (*table_.lines)[row.line].line << "\"\n";
+    }
+  }
 
-  return true;
+  for (auto &b : blocks_)
+    b->print(depth + 1);
 }
 
-bool
+void
 CMarkdownBlock::
-isOrderedListLine(const QString &str, ListData &list) const
+toText(CMarkdownEmitter &emitter) const
 {
-  int len = str.length();
+  // block outside render range has no output (nested blocks still parsed so
+  // headings are indexed for the whole document)
+  if (markdown()->isSkipOutput()) {
+    markdown()->setBlockSkipped();
 
-  int i = 0;
+    if (CMarkdown::isRecurseType(type_) && ! processed_) {
+      CMarkdownBlock *th = const_cast<CMarkdownBlock *>(this);
 
-  if (CMarkdownParse::skipSpace(str, i) >= 4)
-    return false;
+      th->processBlocks(emitter);
+    }
+    else {
+      for (auto &b : blocks_)
+        b->toText(emitter);
+    }
 
-  if (i >= len - 2)
-    return false;
+    return;
+  }
 
-  if (i >= len || ! str[i].isDigit())
-    return false;
+  PhaseScope scope(markdown(), CMarkdown::Phase::EMIT);
 
-  QString num;
+  CMARKDOWN_TRACE_SCOPE("emit", CMarkdown::typeCName(type_), "line " + std::to_string(srcLine_ + 1));
 
-  while (i < len && str[i].isDigit())
-    num += str[i++];
+  if (type_ == CMarkdownTagType::PRE) {
+    codeBlockText(emitter);
+    return;
+  }
 
-  list.n = num.toInt();
+  if (type_ == CMarkdownTagType::TABLE) {
+    tableText(emitter);
+    return;
+  }
 
-  if (i >= len || (str[i] != '.' && str[i] != ')'))
-    return false;
+  // block quote and list item contents parsed and output into this output
+  bool parse = (CMarkdown::isRecurseType(type_) && ! processed_);
 
-  list.c = str[i++];
+  bool single = CMarkdown::isSingleLineType(type_);
 
-  if (i >= len || ! str[i].isSpace())
-    return false;
+  bool empty = false;
 
-  ++i;
+  if (single) {
+    if      (parse)
+      empty = ! hasContent();
+    else if (! processed_)
+      empty = (lines_.empty() && blocks_.empty());
+    else
+      empty = blocks_.empty();
+  }
 
-  CMarkdownParse::skipSpace(str, i);
+  if (empty) {
+    blockStartTag(emitter, /*empty*/true);
+    emitter.newline();
+  }
+  else {
+    blockStartTag(emitter);
 
-  list.indent = i;
+    if (! single)
+      emitter.newline();
 
-  list.text = str.mid(i);
+    if      (parse) {
+      CMarkdownBlock *th = const_cast<CMarkdownBlock *>(this);
 
-  return true;
-}
+      th->processBlocks(emitter);
+    }
+    else if (! processed_) {
+      int  nl  = 0;
+      bool brk = false;
 
-bool
-CMarkdownBlock::
-isTableLine(const QString &str) const
-{
-  int len = str.length();
+      std::string line1;
 
-  int i = 0;
+      for (auto &line : lines_) {
+        if (nl > 0) {
+          if (brk)
+            line1 += "\t";
+          else
+            line1 += "\n";
+        }
 
-  if (CMarkdownParse::skipSpace(str, i) >= 4)
-    return false;
+        line1 += line.line;
 
-  if (i >= len || str[i] != '|')
-    return false;
+        brk = line.brk;
 
-  return true;
+        ++nl;
+      }
+
+      replaceEmbeddedStyles(line1, /*code*/false, emitter);
+    }
+
+    // parsed blocks already output
+    if (! parse) {
+      for (auto &b : blocks_)
+        b->toText(emitter);
+    }
+
+    emitter.endTag(type_);
+    emitter.newline();
+  }
 }
 
 void
 CMarkdownBlock::
-parseTableLine(const QString &str)
+anchorText(const std::string &ref, const std::string &title, const std::string &str,
+           CMarkdownEmitter &emitter) const
 {
-  int len = str.length();
+  if (emitter.isHtml()) {
+    emitter.openTag("a");
+    emitter.attr("href", ref);
 
-  int i = 0;
-
-  CMarkdownParse::skipSpace(str, i);
-  assert(i < 4);
+    if (title != "")
+      emitter.attr("title", title);
 
-  assert(i < len && str[i] == '|');
+    emitter.styleAttr(CMarkdownTagType::A);
+    emitter.endOpenTag();
 
-  using Words = std::vector<QString>;
+    replaceEmbeddedStyles(str, /*code*/false, emitter);
 
-  Words words;
+    emitter.closeTag("a");
+  }
+  else {
+    emitter.ttyStartStyle(CMarkdownTagType::A);
 
-  ++i;
+    replaceEmbeddedStyles(str, /*code*/false, emitter);
 
-  QString word;
+    emitter.ttyEndStyle(CMarkdownTagType::A);
+  }
+}
 
-  while (i < len) {
-    if (str[i] == '|') {
-      ++i;
+void
+CMarkdownBlock::
+emphasisText(const std::string &str, CMarkdownEmitter &emitter) const
+{
+  if (emitter.isHtml()) {
+    emitter.startTag(CMarkdownTagType::EM);
 
-      words.push_back(word);
+    replaceEmbeddedStyles(str, /*code*/false, emitter);
 
-      word = "";
-    }
-    else
-      word += str[i++];
+    emitter.endTag(CMarkdownTagType::EM);
   }
+  else {
+    emitter.raw("\033[3m");
+    emitter.ttyStartStyle(CMarkdownTagType::EM);
 
-  if (words.empty())
-    return;
+    replaceEmbeddedStyles(str, /*code*/false, emitter);
 
-  startBlock(CMarkdownTagType::TR);
+    emitter.raw("\033[0m");
+  }
+}
 
-  for (const auto &word : words) {
-    startBlock(CMarkdownTagType::TD);
+void
+CMarkdownBlock::
+boldText(const std::string &str, CMarkdownEmitter &emitter) const
+{
+  if (emitter.isHtml()) {
+    emitter.startTag(CMarkdownTagType::STRONG);
 
-    addBlockLine(word);
+    replaceEmbeddedStyles(str, /*code*/false, emitter);
 
-    endBlock();
+    emitter.endTag(CMarkdownTagType::STRONG);
   }
+  else {
+    emitter.raw("\033[1m");
+    emitter.ttyStartStyle(CMarkdownTagType::STRONG);
 
-  endBlock();
+    replaceEmbeddedStyles(str, /*code*/false, emitter);
+
+    emitter.raw("\033[0m");
+  }
 }
 
-QString
+void
 CMarkdownBlock::
-replaceEmbeddedStyles(const QString &str, bool code, CMarkdown::Format format) const
+strikeText(const std::string &str, CMarkdownEmitter &emitter) const
 {
-  QString str1;
+  if (emitter.isHtml()) {
+    emitter.startTag(CMarkdownTagType::STRIKE);
 
-  int i   = 0;
-  int len = str.length();
+    replaceEmbeddedStyles(str, /*code*/false, emitter);
 
-  while (i < len) {
-    // escape
-    if      (i < len - 1 && str[i] == '\\' && CMarkdownParse::isASCIIPunct(str[i + 1])) {
-      ++i;
+    emitter.endTag(CMarkdownTagType::STRIKE);
+  }
+  else {
+    emitter.raw("\033[9m");
+    emitter.ttyStartStyle(CMarkdownTagType::STRIKE);
 
-      if      (str[i] == '<') {
-        str1 += "&lt;"; ++i;
-      }
-      else if (str[i] == '>') {
-        str1 += "&gt;"; ++i;
-      }
-      else if (str[i] == '"') {
-        str1 += "&quot;"; ++i;
-      }
-      else if (str[i] == '&') {
-        str1 += "&amp;"; ++i;
-      }
-      else
-        str1 += str[i++];
-    }
-    // emphasis
-    else if (! code && (str[i] == '*' || str[i] == '_')) {
-      QString str2;
-      int     start2;
+    replaceEmbeddedStyles(str, /*code*/false, emitter);
 
-      int nc = CMarkdownParse::parseSurroundText(str, i, str2, start2);
+    emitter.raw("\033[0m");
+  }
+}
 
-      if (nc > 0) {
-        QString str3 = replaceEmbeddedStyles(str2, /*code*/false, format);
+void
+CMarkdownBlock::
+codeText(const std::string &str, CMarkdownEmitter &emitter) const
+{
+  emitter.openTag("code");
+  emitter.endOpenTag();
 
-        if (nc == 1)
-          str1 += emphasisText(str3, format);
-        else
-          str1 += boldText(str3, format);
-      }
-      else {
-        str1 += str[i++];
-      }
-    }
-    // strike
-    else if (! code && (i < len - 1 && str[i] == '~' && str[i + 1] == '~')) {
-      QString str2;
-      int     start2;
+  replaceEmbeddedStyles(str, /*code*/true, emitter);
 
-      int nc = CMarkdownParse::parseSurroundText(str, i, str2, start2);
+  emitter.closeTag("code");
+}
 
-      if (nc > 1) {
-        QString str3 = replaceEmbeddedStyles(str2, /*code*/false, format);
+void
+CMarkdownBlock::
+codeBlockText(CMarkdownEmitter &emitter) const
+{
+  blockStartTag(emitter);
 
-        str1 += strikeText(str3, format);
-      }
-      else {
-        str1 += str[i++];
-        str1 += str[i++];
-      }
-    }
-    // code
-    else if (! code && (str[i] == '`')) {
-      QString str2;
-      int     start2;
+  if (emitter.isHtml() && code_.lang != "") {
+    emitter.openTag("code");
+    emitter.attr("class", "language-" + code_.lang);
+    emitter.styleAttr(CMarkdownTagType::CODE);
+    emitter.endOpenTag();
+  }
+  else
+    emitter.startTag(CMarkdownTagType::CODE);
 
-      int nc = CMarkdownParse::parseSurroundText(str, i, str2, start2);
+  //---
 
-      if (nc > 0) {
-        QString str3 = replaceEmbeddedStyles(str2, /*code*/true, format);
+  CMarkdown *markdown = this->markdown();
 
-        if (format == CMarkdown::Format::HTML)
-          str1 += QString("<code>%1</code>").arg(str3);
-        else
-          str1 += QString("%1").arg(str3);
-      }
-      else {
-        str1 += str[i++];
-      }
-    }
-    // image link
-    else if (! code && (i < len - 1 && str[i] == '!' && str[i + 1] == '[')) {
-      int i1 = i;
+  int ns;
 
-      i += 2;
+  if (code_.lines && emitter.isHtml() && markdown->isHighlightCode() &&
+      CMarkdownHighlight::getLanguage(code_.lang)) {
+    std::string str;
 
-      QString str2;
+    for (int l = code_.start; l < code_.end; ++l) {
+      const std::string &line = (*code_.lines)[l].line;
 
-      while (i < len && str[i] != ']')
-        str2 += str[i++];
+      int i = codeLineStart(line, ns);
 
-      if (i < len && str[i] == ']') {
-        ++i;
+      if (ns > 0)
+        str += std::string(ns, ' ');
 
-        QString str3, str4;
+      str.append(line.data() + i, line.length() - i);
 
-        if      (i < len && str[i] == '(') {
-          ++i;
+      str += '\n';
+    }
 
-          while (i < len && str[i] != ')') {
-            if (str[i] == '\"')
-              break;
+    markdown->highlight().highlight(code_.lang, str, emitter);
+  }
+  else if (code_.lines) {
+    for (int l = code_.start; l < code_.end; ++l) {
+      const std::string &line = (*code_.lines)[l].line;
 
-            str3 += str[i++];
-          }
+      int i = codeLineStart(line, ns);
 
-          if (i < len && str[i] == '\"') {
-            ++i;
+      for ( ; ns > 0; --ns)
+        emitter.raw(' ');
 
-            while (i < len && str[i] != ')') {
-              if (str[i] == '\"')
-                break;
+      emitter.text(line.data() + i, line.length() - i);
 
-              str4 += str[i++];
-            }
-          }
+      emitter.newline();
+    }
+  }
 
-          while (i < len && str[i] != ')')
-            ++i;
+  //---
 
-          if (i < len && str[i] == ')') {
-            ++i;
+  emitter.endTag(CMarkdownTagType::CODE);
+  emitter.endTag(CMarkdownTagType::PRE);
 
-            str3 = str3.simplified();
-
-            // TODO: title
-            if (format == CMarkdown::Format::HTML) {
-              if (str4 != "") {
-                if (str2 != "")
-                  str1 += QString("<img src=\"%1\" title=\"%2\" alt=\"%3\"/>").
-                            arg(imageSrc(str3)).arg(str4).arg(str2);
-                else
-                  str1 += QString("<img src=\"%1\" title=\"%2\"/>").
-                            arg(imageSrc(str3)).arg(str4);
-              }
-              else {
-                if (str2 != "")
-                  str1 += QString("<img src=\"%1\" alt=\"%2\"/>").arg(imageSrc(str3)).arg(str2);
-                else
-                  str1 += QString("<img src=\"%1\"/>").arg(imageSrc(str3));
-              }
-            }
-            else {
-              str1 += QString("%1").arg(imageSrc(str3));
-            }
-          }
-          else {
-            i = i1;
+  emitter.newline();
+}
 
-            str1 += str[i++];
-          }
-        }
-        else if (i < len && str[i] == '[') {
-          ++i;
+// write table rows in one pass over the cell ranges. Missing cells are output
+// empty. For TTY cells are rendered first and padded to the widest rendered cell
+// of each column (inline markup removed, escapes not counted).
+void
+CMarkdownBlock::
+tableText(CMarkdownEmitter &emitter) const
+{
+  const TableSpan &table = table_;
 
-          while (i < len && str[i] != ']')
-            str3 += str[i++];
+  if (! table.lines)
+    return;
 
-          if (i < len && str[i] == ']') {
-            ++i;
+  auto cellText = [&](const TableSpan::Row &row, int c, CMarkdownEmitter &emitter) {
+    if (c >= row.ncell)
+      return;
 
-            if (format == CMarkdown::Format::HTML) {
-              if (str2 != "")
-                str1 += QString("<img src=\"%1\" alt=\"%2\"/>").arg(imageSrc(str3)).arg(str2);
-              else
-                str1 += QString("<img src=\"%1\"/>").arg(imageSrc(str3));
-            }
-            else {
-              str1 += QString("%1").arg(imageSrc(str3));
-            }
-          }
-          else {
-            i = i1;
+    const std::string     &line = (*table.lines)[row.line].line;
+    const TableSpan::Cell &cell = table.cells[row.cell + c];
 
-            str1 += str[i++];
-          }
-        }
-        else {
-          LinkRef ref;
+    replaceEmbeddedStyles(CMarkdownString::mid(line, cell.start, cell.len),
+                          /*code*/false, emitter);
+  };
 
-          if (markdown()->getLink(str2, ref)) {
-            if (format == CMarkdown::Format::HTML) {
-              if (ref.title != "") {
-                if (ref.ref != "")
-                  str1 += QString("<img src=\"%1\" alt=\"%2\" title=\"%3\"/>").
-                           arg(imageSrc(ref.dest)).arg(ref.ref).arg(ref.title);
-                else
-                  str1 += QString("<img src=\"%1\" title=\"%3\"/>").
-                           arg(imageSrc(ref.dest)).arg(ref.title);
-              }
-              else {
-                if (ref.ref != "")
-                  str1 += QString("<img src=\"%1\" alt=\"%2\"/>").
-                           arg(imageSrc(ref.dest)).arg(ref.ref);
-                else
-                  str1 += QString("<img src=\"%1\"/>").
-                           arg(imageSrc(ref.dest));
-              }
-            }
-            else {
-              str1 += QString("%1").arg(imageSrc(ref.dest));
-            }
-          }
-          else {
-            i = i1;
+  auto align = [&](int c) {
+    return (c < int(table.aligns.size()) ? table.aligns[c] : CMarkdown::Align::NONE);
+  };
 
-            str1 += str[i++];
-          }
+  blockStartTag(emitter);
+
+  emitter.newline();
+
+  int nr = int(table.rows.size());
+
+  if (emitter.isHtml()) {
+    for (int r = 0; r < nr; ++r) {
+      const TableSpan::Row &row = table.rows[r];
+
+      bool header = (table.header && r == 0);
+
+      // header row in thead, others in tbody
+      if (table.header && r <= 1) {
+        if (r == 1) {
+          emitter.closeTag("thead");
+          emitter.newline();
         }
-      }
-      else {
-        i = i1;
 
-        str1 += str[i++];
+        emitter.openTag(r == 0 ? "thead" : "tbody");
+        emitter.endOpenTag();
+        emitter.newline();
       }
-    }
-    // link
-    else if (! code && str[i] == '[') {
-      int i1 = i;
 
-      ++i;
+      emitter.startTag(CMarkdownTagType::TR);
+      emitter.newline();
 
-      // link text
-      QString str2;
+      CMarkdownTagType type = (header ? CMarkdownTagType::TH : CMarkdownTagType::TD);
 
-      while (i < len && str[i] != ']')
-        str2 += str[i++];
+      for (int c = 0; c < table.columns; ++c) {
+        emitter.openTag(CMarkdown::getTagData(type).name);
 
-      if (i < len && str[i] == ']') {
-        ++i;
+        switch (align(c)) {
+          case CMarkdown::Align::LEFT  : emitter.attr("align", "left"  ); break;
+          case CMarkdown::Align::CENTER: emitter.attr("align", "center"); break;
+          case CMarkdown::Align::RIGHT : emitter.attr("align", "right" ); break;
+          default:                                                        break;
+        }
 
-        QString str3;
+        emitter.styleAttr(type);
+        emitter.endOpenTag();
 
-        // '(' href "title" ')'
-        if      (i < len && str[i] == '(') {
-          ++i;
+        cellText(row, c, emitter);
 
-          while (i < len && str[i] != ')')
-            str3 += str[i++];
+        emitter.closeTag(CMarkdown::getTagData(type).name);
+        emitter.newline();
+      }
 
-          if (i < len && str[i] == ')') {
-            ++i;
+      emitter.endTag(CMarkdownTagType::TR);
+      emitter.newline();
+    }
 
-            // split into href and title
-            QString href, title;
+    if (table.header) {
+      emitter.closeTag(nr > 1 ? "tbody" : "thead");
+      emitter.newline();
+    }
+  }
+  else {
+    struct TtyCell {
+      std::string text;
+      int         width { 0 }; // visible width of text
+    };
 
-            splitLinkRef(str3, href, title);
+    std::vector<TtyCell> ttyCells(size_t(nr)*table.columns);
+    std::vector<int>     widths(table.columns, 0);
 
-            str1 += anchorText(href, title, str2, format);
-          }
-          else {
-            i = i1;
+    for (int r = 0; r < nr; ++r) {
+      const TableSpan::Row &row = table.rows[r];
 
-            str1 += str[i++];
-          }
-        }
-        // '[' href ']'
-        else if (i < len && str[i] == '[') {
-          ++i;
+      bool header = (table.header && r == 0);
 
-          while (i < len && str[i] != ']')
-            str3 += str[i++];
+      for (int c = 0; c < table.columns; ++c) {
+        CMarkdownEmitter cellEmitter(CMarkdown::Format::TTY);
 
-          if (i < len && str[i] == ']') {
-            ++i;
+        cellEmitter.ttyStartCell();
 
-            LinkRef ref;
+        if (header)
+          cellEmitter.raw("\033[1m");
 
-            if (markdown()->getLink(str3, ref))
-              str1 += anchorText(ref.dest, ref.title, str2, format);
-            else
-              str1 += anchorText(str3, "", str2, format);
-          }
-          else {
-            i = i1;
+        cellText(row, c, cellEmitter);
 
-            str1 += str[i++];
-          }
-        }
-        // no href so lookup
-        else {
-          LinkRef ref;
+        if (header)
+          cellEmitter.raw("\033[0m");
 
-          if (markdown()->getLink(str2, ref))
-            str1 += anchorText(ref.dest, ref.title, ref.ref, format);
-          else {
-            i = i1;
+        TtyCell &cell = ttyCells[size_t(r)*table.columns + c];
 
-            str1 += str[i++];
-          }
-        }
-      }
-      else {
-        i = i1;
+        cell.width = cellEmitter.ttyEndCell(0, CMarkdown::Align::NONE, /*last*/true);
+        cell.text  = cellEmitter.takeText();
 
-        str1 += str[i++];
+        widths[c] = std::max(widths[c], cell.width);
       }
     }
-    // TODO: auto links
 
-    // escape special chars
-    else if (str[i] == '<') {
-      QString ref;
+    for (int r = 0; r < nr; ++r) {
+      bool header = (table.header && r == 0);
+
+      for (int c = 0; c < table.columns; ++c) {
+        if (c > 0)
+          emitter.raw("  ");
 
-      if (isAutoLink(str, i, ref)) {
-        QString ref1 = replaceEmbeddedStyles(ref, /*code*/false, format);
+        const TtyCell &cell = ttyCells[size_t(r)*table.columns + c];
 
-        str1 += anchorText(ref, "", ref1, format);
+        emitter.ttyCell(cell.text, cell.width, widths[c], align(c), c == table.columns - 1);
       }
-      else {
-        str1 += "&lt;"; ++i;
+
+      emitter.newline();
+
+      // rule under header
+      if (header) {
+        for (int c = 0; c < table.columns; ++c) {
+          if (c > 0)
+            emitter.raw("  ");
+
+          std::string rule;
+
+          for (int i = 0; i < widths[c]; ++i)
+            rule += "\u2500";
+
+          emitter.raw(rule);
+        }
+
+        emitter.newline();
       }
     }
-    else if (str[i] == '>') {
-      str1 += "&gt;"; ++i;
-    }
-    else if (str[i] == '"') {
-      str1 += "&quot;"; ++i;
-    }
-    else if (str[i] == '&') {
-      str1 += "&amp;"; ++i;
-    }
-    else
-      str1 += str[i++];
   }
 
-  return str1;
+  emitter.endTag(type_);
+  emitter.newline();
 }
 
-QString
+// write block start tag (with source position if enabled)
+void
 CMarkdownBlock::
-imageSrc(const QString &filename) const
+blockStartTag(CMarkdownEmitter &emitter, bool empty) const
 {
-  return QUrl::fromLocalFile(filename).toEncoded();
-  //return QString("file:%1").arg(filename);
+  SourcePos pos;
+
+  if (emitter.isHtml() && markdown()->isSourcePos())
+    pos = sourcePos();
+
+  bool id = (emitter.isHtml() && markdown()->isHeadingIds() && id_ != "");
+
+  if (! pos.isValid() && ! id) {
+    if (empty)
+      emitter.fullTag(type_);
+    else
+      emitter.startTag(type_);
+
+    return;
+  }
+
+  emitter.openTag(CMarkdown::getTagData(type_).name);
+
+  if (id)
+    emitter.attr("id", id_);
+
+  if (pos.isValid())
+    emitter.attr("data-sourcepos",
+      std::to_string(pos.startLine + 1) + ":" + std::to_string(pos.startColumn + 1) + "-" +
+      std::to_string(pos.endLine   + 1) + ":" + std::to_string(pos.endColumn));
+
+  if (empty)
+    emitter.endEmptyTag();
+  else {
+    emitter.styleAttr(type_);
+    emitter.endOpenTag();
+  }
 }
 
-void
+CMarkdown::SourcePos
 CMarkdownBlock::
-splitLinkRef(const QString &str, QString &href, QString &title) const
+sourcePos() const
 {
-  int i   = 0;
-  int len = str.size();
+  int l1 = -1, l2 = -1;
 
-  href = "";
-
-  while (i < len && ! str[i].isSpace()) {
-    href += str[i++];
-  }
+  auto addLine = [&](int l) {
+    if (l < 0) return;
 
-  CMarkdownParse::skipSpace(str, i);
+    if (l1 < 0 || l < l1) l1 = l;
+    if (l2 < 0 || l > l2) l2 = l;
+  };
 
-  // check for title
-  title = "";
+  addLine(srcLine_);
 
-  if (i < len && (str[i] == '"' || str[i] == '\'')) {
-    QChar c = str[i++];
+  // blank lines (e.g. end of list item) not included
+  for (const auto &line : lines_) {
+    if (! line.line.empty())
+      addLine(line.src);
 
-    while (i < len && str[i] != c)
-      title += str[i++];
+    // container not yet processed
+    if (line.block) {
+      SourcePos pos = line.block->sourcePos();
 
-    if (str[i] == c) {
-      ++i;
+      addLine(pos.startLine);
+      addLine(pos.endLine);
     }
   }
 
-  // TODO: error handling
+  if (code_.lines) {
+    for (int l = code_.start; l < code_.end; ++l)
+      addLine((*code_.lines)[l].src);
+  }
+
+  if (table_.lines && ! table_.rows.empty()) {
+    addLine((*table_.lines)[table_.rows.front().line].src);
+    addLine((*table_.lines)[table_.rows.back ().line].src);
+  }
+
+  for (const auto &b : blocks_) {
+    SourcePos pos = b->sourcePos();
+
+    addLine(pos.startLine);
+    addLine(pos.endLine);
+  }
+
+  return markdown()->linesSourcePos(l1, l2);
 }
 
-QString
+// get start of code line after indent (tab stops every 4 columns) and
+// number of spaces to keep from partially consumed tab
+int
 CMarkdownBlock::
-replaceHtmlChars(const QString &str) const
+codeLineStart(const std::string &line, int &ns) const
 {
-  QString str1;
+  int i = 0, nc = 0;
 
-  int i   = 0;
-  int len = str.length();
+  while (i < int(line.size()) && nc < code_.indent) {
+    if      (line[i] == ' ' ) ++nc;
+    else if (line[i] == '\t') nc += 4 - (nc % 4);
+    else break;
 
-  while (i < len) {
-    if      (str[i] == '<') {
-      str1 += "&lt;"; ++i;
-    }
-    else if (str[i] == '>') {
-      str1 += "&gt;"; ++i;
-    }
-    else if (str[i] == '"') {
-      str1 += "&quot;"; ++i;
-    }
-    else if (str[i] == '&') {
-      str1 += "&amp;"; ++i;
-    }
-    else
-      str1 += str[i++];
+    ++i;
   }
 
-  return str1;
+  ns = nc - code_.indent;
+
+  if (ns < 0)
+    ns = 0;
+
+  return i;
 }
 
-bool
+void
 CMarkdownBlock::
-isAutoLink(const QString &str, int &i, QString &ref) const
+imageText(const std::string &src, const std::string &title, const std::string &alt,
+          CMarkdownEmitter &emitter) const
 {
-  int i1 = i;
+  if (emitter.isHtml()) {
+    emitter.openTag("img");
+    emitter.attr("src", src);
+
+    if (title != "")
+      emitter.attr("title", title);
+
+    if (alt != "")
+      emitter.attr("alt", alt);
+
+    emitter.endEmptyTag();
+  }
+  else {
+    emitter.text(src);
+  }
+}
 
+//------
+
+// get ATX header type, text range and inside text
+bool
+CMarkdownParse::
+isATXHeader(const std::string &str, CMarkdownBlock::ATXData &atxData, int &istart, int &iend)
+{
   int len = str.length();
 
-  if (i1 >= len || str[i1] != '<')
+  int i = 0;
+
+  // up to 3 spaces
+  if (skipSpace(str, i) > 3)
     return false;
 
-  CMarkdownParse::skipSpace(str, i1);
+  istart = i;
 
-  ++i1;
+  // followed by hash (max of 6 hashes)
+  int nh = skipChar(str, i, '#');
 
-  QString scheme;
+  if (nh < 1 || nh > 6)
+    return false;
 
-  while (i1 < len && ! str[i1].isSpace() && str[i1] != ':') {
-    if (! str[i1].isLetter())
-      return false;
+  // followed by a space or end of line
+  if (i < len && ! CMarkdownString::isSpace(str[i]))
+    return false;
 
-    scheme += str[i1++];
-  }
+  // get header type
+  if      (nh == 1) atxData.type = CMarkdownTagType::H1;
+  else if (nh == 2) atxData.type = CMarkdownTagType::H2;
+  else if (nh == 3) atxData.type = CMarkdownTagType::H3;
+  else if (nh == 4) atxData.type = CMarkdownTagType::H4;
+  else if (nh == 5) atxData.type = CMarkdownTagType::H5;
+  else if (nh == 6) atxData.type = CMarkdownTagType::H6;
 
-  CMarkdownParse::skipSpace(str, i1);
+  // skip spaces after '#'
+  CMarkdownParse::skipSpace(str, i);
 
-  if (i1 >= len || str[i1] != ':')
-    return false;
+  // get remaining text
+  atxData.text = CMarkdownString::mid(str, i);
 
-  ++i1;
+  iend = i;
 
-  CMarkdownParse::skipSpace(str, i1);
+  // remove trailing '#'
+  if (atxData.text != "") {
+    if (atxData.text[0] == '#')
+      atxData.text = " " + atxData.text;
 
-  QString ref1;
+    int len1 = atxData.text.length();
 
-  while (i1 < len && str[i1] != '>')
-    ref1 += str[i1++];
+    int i1 = len1 - 1;
 
-  if (i1 >= len || str[i1] != '>')
-    return false;
+    backSkipSpace(atxData.text, i1);
 
-  ++i1;
+    iend += i1;
 
-  ref = QString("%1:%2").arg(scheme).arg(ref1);
+    backSkipChar(atxData.text, i1, '#');
 
-  //ref = str.mid(i + 1, i1 - i - 2);
+    if (i1 >= 0 && CMarkdownString::isSpace(atxData.text[i1])) {
+      backSkipSpace(atxData.text, i1);
 
-  i = i1;
+      atxData.text = CMarkdownString::mid(atxData.text, 0, i1 + 1);
+    }
+  }
 
   return true;
 }
 
+// get link reference details from string with text range
 bool
-CMarkdownBlock::
-getLine(LineData &line)
+CMarkdownParse::
+isLinkReference(const std::string &str, CMarkdown::LinkRef &link, int &istart, int &iend)
 {
-  line.brk = false;
+  int len = str.length();
+
+  int i = 0;
 
-  if (currentLine_ >= int(lines_.size()))
+  if (skipSpace(str, i) > 3)
     return false;
 
-  QString str = lines_[currentLine_++].line;
+  // '[' link reference ']'
+  if (i >= len || str[i] != '[')
+    return false;
 
-  QString spaces;
-  int     ns = 0;
+  istart = i;
 
-  int len = str.size();
+  ++i;
 
-  int i = 0;
+  link.ref = "";
 
-  line.line  = "";
-  line.blank = true;
+  while (i < len && str[i] != ']') {
+    link.ref += str[i++];
+  }
 
-  while (i < len && str[i] != '\n') {
-    if (str[i].isSpace()) {
-      // expand tabs
-      if (str[i] == '\t')
-        spaces += "    ";
-      else
-        spaces += " ";
+  if (i >= len)
+    return false;
 
-      ++ns;
-      ++i;
-    }
-    else {
-      line.line += spaces;
+  ++i;
 
-      spaces = "";
-      ns     = 0;
+  if (i >= len || str[i] != ':')
+    return false;
 
-      line.blank = false;
+  ++i;
 
-      line.line += str[i++];
-    }
+  skipSpace(str, i);
+
+  //---
+
+  // link destination
+
+  // TODO: <> enclosed link
+  // TODO: allow line ending ?
+
+  link.dest = "";
+
+  while (i < len && ! CMarkdownString::isSpace(str[i])) {
+    link.dest += str[i++];
   }
 
-  if (ns >= 2)
-    line.brk = true;
+  iend = i;
 
-  line.indent = 0;
+  skipSpace(str, i);
 
-  CMarkdownParse::skipSpace(line.line, line.indent);
+  //---
 
-  return true;
-}
+  // link title
 
-void
-CMarkdownBlock::
-ungetLine()
-{
-  assert(currentLine_ > 0);
+  link.title = "";
 
-  --currentLine_;
-}
+  if (i < len && (str[i] == '"' || str[i] == '\'')) {
+    char c = str[i++];
 
-CMarkdownBlock *
-CMarkdownBlock::
-startBlock(CMarkdownTagType type)
-{
-  CMarkdownBlock *block = new CMarkdownBlock(currentBlock_, type);
+    while (i < len && str[i] != c)
+      link.title += str[i++];
 
-  currentBlock_->addBlock(block);
+    if (i >= len || str[i] != c)
+      return false;
 
-  currentBlock_ = block;
+    ++i;
+
+    iend = i;
+  }
 
-  if (markdown()->isDebug())
-    std::cerr << "DEBUG: startBlock " << CMarkdown::typeName(type).toStdString() << "\n";
+  //---
 
-  return block;
-}
+  skipSpace(str, i);
 
-void
-CMarkdownBlock::
-addBlockLine(const QString &line, bool brk)
-{
-  if (markdown()->isDebug())
-    std::cerr << "DEBUG: add: " << line.toStdString() << "\n";
+  if (i < len)
+    return false;
 
-  currentBlock_->addLine(Line(line, brk));
+  return true;
 }
 
-void
-CMarkdownBlock::
-appendBlockLine(const QString &line)
+bool
+CMarkdownParse::
+isRule(const std::string &str, int &istart, int &iend)
 {
-  if (markdown()->isDebug())
-    std::cerr << "DEBUG: append: " << line.toStdString() << "\n";
+  int len = str.length();
 
-  currentBlock_->appendLine(line);
-}
+  int i = 0;
 
-void
-CMarkdownBlock::
-flushBlocks()
-{
-  while (currentBlock_ != rootBlock_)
-    endBlock();
-}
+  // max of three spaces indent
+  if (skipSpace(str, i) >= 4)
+    return false;
 
-CMarkdownBlock *
-CMarkdownBlock::
-endBlock()
-{
-  if (currentBlock_ == rootBlock_)
-    return nullptr;
+  // check for rule characters
+  if (i >= len)
+    return false;
 
-  if (markdown()->isDebug())
-    std::cerr << "DEBUG: endBlock " <<
-      CMarkdown::typeName(currentBlock_->blockType()).toStdString() << "\n";
+  char c = str[i];
 
-  currentBlock_ = currentBlock_->parent();
+  if (c != '-' && c != '*' && c != '_')
+    return false;
 
-  return currentBlock_;
-}
+  istart = i;
 
-void
-CMarkdownBlock::
-print(int depth) const
-{
-  QString tag = CMarkdown::typeName(type_);
+  ++i;
 
-  for (int i = 0; i < depth; ++i)
-    std::cout << "  ";
+  // check for three or more matching characters (with spaces between)
+  int nc = 1;
 
-  std::cout << QString("-> %1").arg(tag).toStdString() << "\n";
+  while (i < len) {
+    skipSpace(str, i);
 
-  for (auto &l : lines_) {
-    for (int i = 0; i < depth; ++i)
-      std::cout << "  ";
+    if (i >= len || str[i] != c)
+      return false;
 
-    std::cout << "  \"" << l.line.toStdString() << "\"\n";
+    ++i; ++nc;
   }
 
-  for (auto &b : blocks_)
-    b->print(depth + 1);
+  iend = i;
+
+  return (nc >= 3);
 }
 
-QString
-CMarkdownBlock::
-toText(CMarkdown::Format format) const
+// check for char surrounded text
+int
+CMarkdownParse::
+parseSurroundText(const std::string &str, int &i, std::string &str1, int &start1)
 {
-  CMarkdownBlock *th = const_cast<CMarkdownBlock *>(this);
-
-  th->process(format);
+  return parseSurroundText(str, i, str[i], str1, start1);
+}
 
-  //---
+// check for char surrounded text
+int
+CMarkdownParse::
+parseSurroundText(const std::string &str, int &i, char c, std::string &str1, int &start1)
+{
+  int len = str.length();
 
-  QString text;
+  if (i >= len || str[i] != c)
+    return 0;
 
-  bool single = CMarkdown::isSingleLineType(type_);
+  int  i1    = i;
+  bool found = false;
 
-  bool empty = false;
+  // count number of start characters
+  int nc = 1;
 
-  if (single) {
-    if (! processed_)
-      empty = (lines_.empty() && blocks_.empty());
-    else
-      empty = blocks_.empty();
-  }
+  ++i;
 
-  if (empty) {
-    text += fullTag(type_, format) + "\n";
+  while (i < len && str[i] == c) {
+    ++nc; ++i;
   }
-  else {
-    text += startTag(type_, format);
-
-    if (! single)
-      text += "\n";
-
-    if (! processed_) {
-      int  nl  = 0;
-      bool brk = false;
 
-      QString line1;
-
-      for (auto &line : lines_) {
-        if (nl > 0) {
-          if (brk)
-            line1 += "\t";
-          else
-            line1 += "\n";
-        }
+  // search for matching number of end characters
+  while (i < len) {
+    if      (i < len - 1 && str[i] == '\\' && CMarkdownParse::isASCIIPunct(str[i + 1])) {
+      ++i;
 
-        line1 += line.line;
+      str1 += str[i++];
+    }
+    else if (str[i] == c) {
+      ++i;
 
-        brk = line.brk;
+      int nc1 = 1;
 
-        ++nl;
+      while (i < len && nc1 < nc && str[i] == c) {
+        ++nc1; ++i;
       }
 
-      if (type_ !=  CMarkdownTagType::CODE)
-        line1 = replaceEmbeddedStyles(line1, /*code*/false, format);
-
-      QString line2;
-
-      for (int i = 0; i < line1.size(); ++i) {
-        if (line1[i] == '\t') {
-          if (format == CMarkdown::Format::HTML)
-            line2 += "<br>\n";
-          else
-            line2 += "\n";
-        }
-        else
-          line2 += line1[i];
+      if (nc1 == nc) {
+        found = true;
+        break;
       }
 
-      text += line2;
-    }
-
-    int nb = 0;
+      if (str1 == "")
+        start1 = i;
 
-    for (auto &b : blocks_) {
-      text += b->toText(format);
+      for (int j = 0; j < nc1; ++j)
+        str1 += c;
+    }
+    else {
+      if (str1 == "")
+        start1 = i;
 
-      ++nb;
+      str1 += str[i++];
     }
+  }
 
-    text += endTag(type_, format) + "\n";
+  if (! found) {
+    i = i1;
+    return 0;
   }
 
-  return text;
+  return nc;
 }
 
-QString
-CMarkdownBlock::
-anchorText(const QString &ref, const QString &title, const QString &str,
-           CMarkdown::Format format) const
+// skip char surrounded text ending before len (no copy of text)
+int
+CMarkdownParse::
+skipSurroundText(const std::string &str, int &i, char c, int len)
 {
-  QString text;
+  if (i >= len || str[i] != c)
+    return 0;
 
-  if (format == CMarkdown::Format::HTML) {
-    text = QString("<a href=\"%1\"").arg(ref);
+  int i1 = i;
 
-    if (title != "")
-      text += QString(" title=\"%1\"").arg(title);
+  // count number of start characters
+  int nc = 1;
 
-    text += htmlStyle(CMarkdownTagType::A);
+  ++i;
 
-    text += QString(">%1</a>").arg(str);
-  }
-  else {
-    text = QString("%1%2%3").
-      arg(ttyStartStyle(CMarkdownTagType::A)).arg(str).arg(ttyEndStyle(CMarkdownTagType::A));
+  while (i < len && str[i] == c) {
+    ++nc; ++i;
   }
 
-  return text;
-}
+  // search for matching number of end characters
+  while (i < len) {
+    if      (i < len - 1 && str[i] == '\\' && CMarkdownParse::isASCIIPunct(str[i + 1])) {
+      i += 2;
+    }
+    else if (str[i] == c) {
+      ++i;
 
-QString
-CMarkdownBlock::
-emphasisText(const QString &str, CMarkdown::Format format) const
-{
-  QString text;
+      int nc1 = 1;
 
-  if (format == CMarkdown::Format::HTML)
-    text = QString("<em%1>%2</em>").arg(htmlStyle(CMarkdownTagType::EM)).arg(str);
-  else
-    text = QString("[3m%1%2[0m").arg(ttyStartStyle(CMarkdownTagType::EM)).arg(str);
+      while (i < len && nc1 < nc && str[i] == c) {
+        ++nc1; ++i;
+      }
+
+      if (nc1 == nc)
+        return nc;
+    }
+    else
+      ++i;
+  }
 
-  return text;
+  i = i1;
+
+  return 0;
 }
 
-QString
-CMarkdownBlock::
-boldText(const QString &str, CMarkdown::Format format) const
+//---
+
+int
+CMarkdownParse::LineContext::
+toState() const
 {
-  QString text;
+  int state = 0;
 
-  if (format == CMarkdown::Format::HTML)
-    text = QString("<strong%1>%2</strong>").arg(htmlStyle(CMarkdownTagType::STRONG)).arg(str);
-  else
-    text = QString("[1m%1%2[0m").arg(ttyStartStyle(CMarkdownTagType::STRONG)).arg(str);
+  if      (fenceChar == '`') state |= 1;
+  else if (fenceChar == '~') state |= 2;
+
+  state |= (std::min(fenceLen, 255) << 2);
+
+  if (paragraph) state |= (1 << 10);
+  if (list     ) state |= (1 << 11);
+  if (quote    ) state |= (1 << 12);
 
-  return text;
+  return state;
 }
 
-QString
-CMarkdownBlock::
-strikeText(const QString &str, CMarkdown::Format format) const
+CMarkdownParse::LineContext
+CMarkdownParse::LineContext::
+fromState(int state)
 {
-  QString text;
+  LineContext context;
 
-  if (format == CMarkdown::Format::HTML)
-    text = QString("<strike%1>%2</strike>").arg(htmlStyle(CMarkdownTagType::STRIKE)).arg(str);
-  else
-    text += QString("[9m%1%2[0m").arg(ttyStartStyle(CMarkdownTagType::STRIKE)).arg(str);
+  // no previous state
+  if (state < 0)
+    return context;
+
+  if      ((state & 3) == 1) context.fenceChar = '`';
+  else if ((state & 3) == 2) context.fenceChar = '~';
+
+  context.fenceLen  = ((state >> 2) & 255);
+  context.paragraph = (state & (1 << 10));
+  context.list      = (state & (1 << 11));
+  context.quote     = (state & (1 << 12));
 
-  return text;
+  return context;
 }
 
-QString
-CMarkdownBlock::
-startTag(CMarkdownTagType type, CMarkdown::Format format) const
+// classify line using context from previous lines and update context for next line
+CMarkdownParse::LineType
+CMarkdownParse::
+classifyLine(const std::string &str, LineContext &context)
 {
-  QString text;
+  // inside fenced code until closing fence
+  if (context.fenceLen > 0) {
+    CMarkdownBlock::CodeFence fence;
 
-  if (format == CMarkdown::Format::HTML) {
-    text = QString("<%1").arg(CMarkdown::typeName(type));
+    fence.c = context.fenceChar;
+    fence.n = context.fenceLen;
 
-    text += htmlStyle(type);
+    if (isEndCodeFence(str, fence)) {
+      context.fenceLen = 0;
 
-    text += ">";
+      return LineType::FENCE;
+    }
 
-    return text;
-  }
-  else {
-    return ttyStartStyle(type);
+    return LineType::CODE;
   }
-}
 
-QString
-CMarkdownBlock::
-endTag(CMarkdownTagType type, CMarkdown::Format format) const
-{
-  if (format == CMarkdown::Format::HTML)
-    return QString("</%1>").arg(CMarkdown::typeName(type));
-  else
-    return ttyEndStyle(type);
-}
+  if (isBlankLine(str)) {
+    context.paragraph = false;
+    context.quote     = false;
 
-QString
-CMarkdownBlock::
-fullTag(CMarkdownTagType type, CMarkdown::Format format) const
-{
-  if (format == CMarkdown::Format::HTML)
-    return QString("<%1/>").arg(CMarkdown::typeName(type));
-  else
-    return "";
-}
+    return LineType::BLANK;
+  }
 
-QString
-CMarkdownBlock::
-htmlStyle(CMarkdownTagType type) const
-{
-  QString color = CMarkdown::typeColor(type);
-  QString font  = CMarkdown::typeFont (type);
+  CMarkdownBlock::CodeFence fence;
 
-  if (color == "" && font == "")
-    return "";
+  if (isStartCodeFence(str, fence)) {
+    context.fenceChar = fence.c;
+    context.fenceLen  = fence.n;
+    context.paragraph = false;
 
-  QString text = " style=\"";
+    return LineType::FENCE;
+  }
 
-  if (color != "")
-    text += QString("color:%1;").arg(color);
+  int i = 0;
 
-  if (font != "") {
-    QStringList fontParts = font.split(":");
+  int indent = skipIndent(str, i);
 
-    if      (fontParts.size() == 1)
-      text += QString("font-family:%1").arg(fontParts[0]);
-    else if (fontParts.size() == 2)
-      text += QString("font-family:%1;font-size:%2;").arg(fontParts[0]).arg(fontParts[1]);
-    else if (fontParts.size() == 3)
-      text += QString("font-family:%1;font-size:%2;font-style:%3").
-                arg(fontParts[0]).arg(fontParts[1]).arg(fontParts[2]);
-  }
+  // indented code (cannot interrupt paragraph, list item content is indented)
+  if (indent >= 4 && ! context.paragraph && ! context.list)
+    return LineType::CODE;
 
-  text += "\"";
+  CMarkdownBlock::ATXData  atxData;
+  CMarkdownBlock::ListData list;
+  CMarkdown::LinkRef       linkRef;
+  std::string_view         quote;
+  int                      istart, iend;
 
-  return text;
-}
+  LineType type = LineType::TEXT;
 
-QString
-CMarkdownBlock::
-ttyStartStyle(CMarkdownTagType type) const
-{
-  QString color = CMarkdown::typeColor(type);
+  if      (isRule(str, istart, iend))
+    type = LineType::RULE;
+  else if (isLinkReference(str, linkRef, istart, iend))
+    type = LineType::LINK_REF;
+  else if (isUnorderedListLine(str, list) || isOrderedListLine(str, list)) {
+    context.list = true;
 
-  if      (color == "black"  ) return "[30m";
-  else if (color == "red"    ) return "[31m";
-  else if (color == "green"  ) return "[32m";
-  else if (color == "yellow" ) return "[33m";
-  else if (color == "blue"   ) return "[34m";
-  else if (color == "magenta") return "[35m";
-  else if (color == "cyan"   ) return "[36m";
-  else if (color == "white"  ) return "[37m";
+    type = LineType::LIST_ITEM;
+  }
+  else if (isATXHeader(str, atxData, istart, iend))
+    type = LineType::HEADER;
+  else if (isBlockQuote(str, quote))
+    type = LineType::QUOTE;
+  else if (isTableLine(str))
+    type = LineType::TABLE;
+  else {
+    // text after block quote paragraph is lazy continuation of quote
+    if (context.quote && context.paragraph)
+      type = LineType::QUOTE;
 
-  return "";
-}
+    // unindented text after blank line ends list
+    if (indent == 0 && ! context.paragraph)
+      context.list = false;
+  }
 
-QString
-CMarkdownBlock::
-ttyEndStyle(CMarkdownTagType type) const
-{
-  QString color = CMarkdown::typeColor(type);
+  // block quote continued by quote and lazy continuation lines
+  context.quote = (type == LineType::QUOTE);
 
-  if (color != "")
-    return "[0m";
+  context.paragraph = (type == LineType::TEXT || type == LineType::QUOTE ||
+                       type == LineType::LIST_ITEM);
 
-  return "";
+  return type;
 }
 
-//------
+//---
 
-// get ATX header type, text range and inside text
 bool
 CMarkdownParse::
-isATXHeader(const QString &str, CMarkdownBlock::ATXData &atxData, int &istart, int &iend)
+isStartCodeFence(const std::string &str, CMarkdownBlock::CodeFence &fence)
 {
   int len = str.length();
 
   int i = 0;
 
-  // up to 3 spaces
-  if (skipSpace(str, i) > 3)
+  if (CMarkdownParse::skipSpace(str, i) > 3)
     return false;
 
-  istart = i;
+  if (i >= len)
+    return false;
 
-  // followed by hash (max of 6 hashes)
-  int nh = skipChar(str, i, '#');
+  fence.c = str[i++];
 
-  if (nh < 1 || nh > 6)
+  if (fence.c != '`' && fence.c != '~')
     return false;
 
-  // followed by a space or end of line
-  if (i < len && ! str[i].isSpace())
-    return false;
+  fence.n = CMarkdownParse::skipChar(str, i, fence.c) + 1;
 
-  // get header type
-  if      (nh == 1) atxData.type = CMarkdownTagType::H1;
-  else if (nh == 2) atxData.type = CMarkdownTagType::H2;
-  else if (nh == 3) atxData.type = CMarkdownTagType::H3;
-  else if (nh == 4) atxData.type = CMarkdownTagType::H4;
-  else if (nh == 5) atxData.type = CMarkdownTagType::H5;
-  else if (nh == 6) atxData.type = CMarkdownTagType::H6;
+  if (fence.n < 3)
+    return false;
 
-  // skip spaces after '#'
   CMarkdownParse::skipSpace(str, i);
 
-  // get remaining text
-  atxData.text = str.mid(i);
-
-  iend = i;
-
-  // remove trailing '#'
-  if (atxData.text != "") {
-    if (atxData.text[0] == '#')
-      atxData.text = " " + atxData.text;
-
-    int len1 = atxData.text.length();
-
-    int i1 = len1 - 1;
-
-    backSkipSpace(atxData.text, i1);
-
-    iend += i1;
-
-    backSkipChar(atxData.text, i1, '#');
+  fence.info = "";
 
-    if (i1 >= 0 && atxData.text[i1].isSpace()) {
-      backSkipSpace(atxData.text, i1);
+  while (i < len) {
+    if (str[i] == '`')
+      return false;
 
-      atxData.text = atxData.text.mid(0, i1 + 1);
-    }
+    fence.info += str[i++];
   }
 
+  fence.info = CMarkdownString::simplified(fence.info);
+
   return true;
 }
 
-// get link reference details from string with text range
 bool
 CMarkdownParse::
-isLinkReference(const QString &str, CMarkdown::LinkRef &link, int &istart, int &iend)
+isEndCodeFence(const std::string &str, const CMarkdownBlock::CodeFence &fence)
 {
   int len = str.length();
 
   int i = 0;
 
-  if (skipSpace(str, i) > 3)
+  if (CMarkdownParse::skipSpace(str, i) > 3)
     return false;
 
-  // '[' link reference ']'
-  if (i >= len || str[i] != '[')
+  if (i >= len)
     return false;
 
-  istart = i;
-
-  ++i;
-
-  link.ref = "";
-
-  while (i < len && str[i] != ']') {
-    link.ref += str[i++];
-  }
-
-  if (i >= len)
+  if (str[i] != fence.c)
     return false;
 
   ++i;
 
-  if (i >= len || str[i] != ':')
+  if (CMarkdownParse::skipChar(str, i, fence.c) < fence.n - 1)
     return false;
 
-  ++i;
+  // only spaces allowed after closing fence
+  CMarkdownParse::skipSpace(str, i);
 
-  skipSpace(str, i);
+  return (i >= len);
+}
 
-  //---
+bool
+CMarkdownParse::
+isBlockQuote(std::string_view str, std::string_view &quote)
+{
+  int len = str.length();
 
-  // link destination
+  int i = 0;
 
-  // TODO: <> enclosed link
-  // TODO: allow line ending ?
+  if (CMarkdownParse::skipSpace(str, i) >= 4)
+    return false;
 
-  link.dest = "";
+  if (i >= len || str[i] != '>')
+    return false;
 
-  while (i < len && ! str[i].isSpace()) {
-    link.dest += str[i++];
-  }
+  ++i;
 
-  iend = i;
+  if (i < len && CMarkdownString::isSpace(str[i]))
+    quote = str.substr(i + 1);
+  else
+    quote = str.substr(i);
 
-  skipSpace(str, i);
+  return true;
+}
 
-  //---
+bool
+CMarkdownParse::
+isUnorderedListLine(std::string_view str, CMarkdownBlock::ListData &list)
+{
+  int len = str.length();
 
-  // link title
+  int i = 0;
 
-  link.title = "";
+  if (CMarkdownParse::skipSpace(str, i) >= 4)
+    return false;
 
-  if (i < len && (str[i] == '"' || str[i] == '\'')) {
-    QChar c = str[i++];
+  if (i >= len - 1)
+    return false;
 
-    while (i < len && str[i] != c)
-      link.title += str[i++];
+  if (str[i] != '-' && str[i] != '+' && str[i] != '*')
+    return false;
 
-    if (i >= len || str[i] != c)
-      return false;
+  list.c = str[i];
 
-    ++i;
+  ++i;
 
-    iend = i;
-  }
+  if (! CMarkdownString::isSpace(str[i]))
+    return false;
 
-  //---
+  ++i;
 
-  skipSpace(str, i);
+  CMarkdownParse::skipSpace(str, i);
 
-  if (i < len)
-    return false;
+  list.indent = i;
 
   return true;
 }
 
 bool
 CMarkdownParse::
-isRule(const QString &str, int &istart, int &iend)
+isOrderedListLine(std::string_view str, CMarkdownBlock::ListData &list)
 {
   int len = str.length();
 
   int i = 0;
 
-  // max of three spaces indent
-  if (skipSpace(str, i) >= 4)
+  if (CMarkdownParse::skipSpace(str, i) >= 4)
     return false;
 
-  // check for rule characters
-  if (i >= len)
+  if (i >= len - 2)
     return false;
 
-  QChar c = str[i];
-
-  if (c != '-' && c != '*' && c != '_')
+  if (i >= len || ! CMarkdownString::isDigit(str[i]))
     return false;
 
-  istart = i;
+  std::string num;
 
-  ++i;
+  while (i < len && CMarkdownString::isDigit(str[i]))
+    num += str[i++];
 
-  // check for three or more matching characters (with spaces between)
-  int nc = 1;
+  // out of range number is zero
+  long n = std::strtol(num.c_str(), nullptr, 10);
 
-  while (i < len) {
-    skipSpace(str, i);
+  list.n = (n <= INT_MAX ? int(n) : 0);
 
-    if (i >= len || str[i] != c)
-      return false;
+  if (i >= len || (str[i] != '.' && str[i] != ')'))
+    return false;
 
-    ++i; ++nc;
-  }
+  list.c = str[i++];
 
-  iend = i;
+  if (i >= len || ! CMarkdownString::isSpace(str[i]))
+    return false;
 
-  return (nc >= 3);
-}
+  ++i;
 
-// check for char surrounded text
-int
-CMarkdownParse::
-parseSurroundText(const QString &str, int &i, QString &str1, int &start1)
-{
-  return parseSurroundText(str, i, str[i], str1, start1);
+  CMarkdownParse::skipSpace(str, i);
+
+  list.indent = i;
+
+  return true;
 }
 
-// check for char surrounded text
-int
+bool
 CMarkdownParse::
-parseSurroundText(const QString &str, int &i, const QChar &c, QString &str1, int &start1)
+isTableLine(const std::string &str)
 {
   int len = str.length();
 
-  if (i >= len || str[i] != c)
-    return 0;
+  int i = 0;
 
-  int  i1    = i;
-  bool found = false;
+  if (CMarkdownParse::skipSpace(str, i) >= 4)
+    return false;
 
-  // count number of start characters
-  int nc = 1;
+  if (i >= len || str[i] != '|')
+    return false;
 
-  ++i;
+  return true;
+}
 
-  while (i < len && str[i] == c) {
-    ++nc; ++i;
-  }
+// get text without inline markup (emphasis and code markers, link destinations,
+// html tags and escapes)
+std::string
+CMarkdownParse::
+plainText(const std::string &str)
+{
+  std::string text;
+
+  int len = str.length();
+
+  int i = 0;
 
-  // search for matching number of end characters
   while (i < len) {
-    if      (i < len - 1 && str[i] == '\\' && CMarkdownParse::isASCIIPunct(str[i + 1])) {
-      ++i;
+    char c = str[i];
 
-      str1 += str[i++];
+    if      (c == '\\' && i < len - 1 && isASCIIPunct(str[i + 1])) {
+      text += str[i + 1];
+
+      i += 2;
     }
-    else if (str[i] == c) {
-      ++i;
+    // code span text kept as is
+    else if (c == '`') {
+      int j = CMarkdownString::indexOf(str, '`', i + 1);
 
-      int nc1 = 1;
+      if (j > i) {
+        text += CMarkdownString::mid(str, i + 1, j - i - 1);
 
-      while (i < len && nc1 < nc && str[i] == c) {
-        ++nc1; ++i;
+        i = j + 1;
       }
+      else
+        ++i;
+    }
+    // link destination or reference skipped
+    else if (c == ']') {
+      ++i;
 
-      if (nc1 == nc) {
-        found = true;
-        break;
-      }
+      if (i < len && (str[i] == '(' || str[i] == '[')) {
+        int j = CMarkdownString::indexOf(str, str[i] == '(' ? ')' : ']', i + 1);
 
-      if (str1 == "")
-        start1 = i;
+        if (j > i)
+          i = j + 1;
+      }
+    }
+    // html tag skipped
+    else if (c == '<' && i < len - 1 &&
+             (CMarkdownString::isAlpha(str[i + 1]) || str[i + 1] == '/')) {
+      int j = CMarkdownString::indexOf(str, '>', i + 1);
 
-      for (int j = 0; j < nc1; ++j)
-        str1 += c;
+      i = (j > i ? j + 1 : i + 1);
+    }
+    // '_' emphasis only at word boundary
+    else if (c == '*' || c == '~' || c == '[' ||
+             (c == '!' && i < len - 1 && str[i + 1] == '[') ||
+             (c == '_' && (i == 0 || i == len - 1 ||
+                           ! CMarkdownString::isAlnum(str[i - 1]) ||
+                           ! CMarkdownString::isAlnum(str[i + 1])))) {
+      ++i;
     }
     else {
-      if (str1 == "")
-        start1 = i;
+      text += c;
 
-      str1 += str[i++];
+      ++i;
     }
   }
 
-  if (! found) {
-    i = i1;
-    return 0;
+  return CMarkdownString::simplified(text);
+}
+
+// get id for heading text: lower case letters, numbers, '-' and '_' with spaces
+// replaced by '-' ("section" if empty)
+std::string
+CMarkdownParse::
+headingSlug(const std::string &text)
+{
+  std::string slug;
+
+  std::string text1 = CMarkdownString::toLower(text);
+
+  for (size_t i = 0; i < text1.size(); ) {
+    char c = text1[i];
+
+    // non-ASCII letters kept (punctuation and symbols removed)
+    if (! CMarkdownString::isContinuation(c) && uint8_t(c) >= 0x80) {
+      size_t i1 = i;
+
+      if (! CMarkdownString::isSymbolChar(CMarkdownString::decodeUtf8(text1, i)))
+        slug.append(text1, i1, i - i1);
+
+      continue;
+    }
+
+    if      (CMarkdownString::isAlnum(c) || c == '-' || c == '_')
+      slug += c;
+    else if (CMarkdownString::isSpace(c))
+      slug += '-';
+
+    ++i;
   }
 
-  return nc;
+  if (slug == "")
+    slug = "section";
+
+  return slug;
 }
 
 bool
 CMarkdownParse::
-isASCIIPunct(const QChar &c)
+isASCIIPunct(char c)
 {
-  static QString chars("!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~");
+  static std::string chars("!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~");
 
-  return (chars.indexOf(c) >= 0);
+  return (CMarkdownString::indexOf(chars, c) >= 0);
 }
 
 bool
 CMarkdownParse::
-isBlankLine(const QString &str)
+isBlankLine(const std::string &str)
 {
   // An empty line, or a line containing only spaces or tabs, is a blank line.
   int i = 0;
 
-  if (skipSpace(str, i) != str.length())
+  if (skipSpace(str, i) != int(str.size()))
     return false;
 
   return true;
@@ -2307,26 +3709,46 @@ isBlankLine(const QString &str)
 
 int
 CMarkdownParse::
-skipSpace(const QString &str, int &i)
+skipSpace(std::string_view str, int &i)
 {
   int len = str.length();
 
   int n = 0;
 
-  while (i < len && str[i].isSpace()) {
+  while (i < len && CMarkdownString::isSpace(str[i])) {
     ++i; ++n;
   }
 
   return n;
 }
 
+// skip leading spaces and tabs returning number of columns (tab stops every 4)
+int
+CMarkdownParse::
+skipIndent(const std::string &str, int &i)
+{
+  int len = str.length();
+
+  int n = 0;
+
+  while (i < len) {
+    if      (str[i] == ' ' ) ++n;
+    else if (str[i] == '\t') n += 4 - (n % 4);
+    else break;
+
+    ++i;
+  }
+
+  return n;
+}
+
 int
 CMarkdownParse::
-backSkipSpace(const QString &str, int &i)
+backSkipSpace(const std::string &str, int &i)
 {
   int n = 0;
 
-  while (i >= 0 && str[i].isSpace()) {
+  while (i >= 0 && CMarkdownString::isSpace(str[i])) {
     --i; ++n;
   }
 
@@ -2335,7 +3757,7 @@ backSkipSpace(const QString &str, int &i)
 
 int
 CMarkdownParse::
-skipChar(const QString &str, int &i, const QChar &c)
+skipChar(const std::string &str, int &i, char c)
 {
   int len = str.length();
 
@@ -2350,7 +3772,7 @@ skipChar(const QString &str, int &i, const QChar &c)
 
 int
 CMarkdownParse::
-backSkipChar(const QString &str, int &i, const QChar &c)
+backSkipChar(const std::string &str, int &i, char c)
 {
   int n = 0;
 
@@ -0,0 +1,39 @@
+TEMPLATE = lib
+
+TARGET = CMarkdown
+
+# core converter (standard library only, no Qt dependency)
+CONFIG -= qt
+
+DEPENDPATH += .
+
+QMAKE_CXXFLAGS += -std=c++17
+
+CONFIG += staticlib
+
+# build options (e.g. trace events) are set in ../include/CMarkdownConfig.h
+
+SOURCES += \
+CMarkdown.cpp \
+CMarkdownConvert.cpp \
+CMarkdownEmitter.cpp \
+CMarkdownHighlight.cpp \
+CMarkdownLinkDict.cpp \
+CMarkdownTrace.cpp \
+
+HEADERS += \
+../include/CMarkdown.h \
+../include/CMarkdownConfig.h \
+../include/CMarkdownConvert.h \
+../include/CMarkdownEmitter.h \
+../include/CMarkdownHighlight.h \
+../include/CMarkdownLinkDict.h \
+../include/CMarkdownString.h \
+../include/CMarkdownTrace.h \
+
+DESTDIR     = ../lib
+OBJECTS_DIR = ../obj/core
+
+INCLUDEPATH += \
+. \
+../include \
@@ -0,0 +1,71 @@
+#include <CMarkdownConvert.h>
+#include <CMarkdown.h>
+#include <CMarkdownEmitter.h>
+#include <CMarkdownLinkDict.h>
+#include <fstream>
+
+namespace {
+
+CMarkdown::Format convertFormat(CMarkdownConvert::Format format) {
+  return (format == CMarkdownConvert::Format::TTY ? CMarkdown::Format::TTY :
+                                                    CMarkdown::Format::HTML);
+}
+
+void applyOptions(CMarkdown &markdown, const CMarkdownConvert::Options &options) {
+  markdown.setHighlightCode(options.highlightCode);
+  markdown.setSourcePos    (options.sourcePos);
+  markdown.setHeadingIds   (options.headingIds);
+  markdown.setToc          (options.toc);
+  markdown.setLinkDict     (options.links);
+}
+
+}
+
+//---
+
+namespace CMarkdownConvert {
+
+std::string
+convert(std::string_view text, Format format, const Options &options)
+{
+  CMarkdown markdown;
+
+  applyOptions(markdown, options);
+
+  return markdown.textToFormat(text, convertFormat(format));
+}
+
+bool
+convertFile(const std::string &filename, std::string &result,
+            Format format, const Options &options)
+{
+  if (filename != "-" && ! std::ifstream(filename))
+    return false;
+
+  CMarkdown markdown;
+
+  applyOptions(markdown, options);
+
+  result = markdown.fileToFormat(filename, convertFormat(format));
+
+  return true;
+}
+
+std::shared_ptr<const CMarkdownLinkDict>
+loadLinks(const std::string &filename)
+{
+  auto dict = std::make_shared<CMarkdownLinkDict>();
+
+  if (! dict->load(filename))
+    return nullptr;
+
+  return dict;
+}
+
+std::string
+encodeUrlPath(std::string_view path)
+{
+  return CMarkdownEmitter::encodeUrlPath(std::string(path));
+}
+
+}
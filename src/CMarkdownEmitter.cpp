@@ -0,0 +1,884 @@
+#include <CMarkdownEmitter.h>
+#include <CMarkdownString.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline bool isEscapeChar(char c, CMarkdownEmitter::Escape escape) {
+  switch (c) {
+    case '<': case '>': case '"': case '&':
+      return true;
+    case '\'':
+      return (escape == CMarkdownEmitter::Escape::ATTR);
+    default:
+      return false;
+  }
+}
+
+}
+
+//---
+
+CMarkdownEmitter::
+CMarkdownEmitter(Format format, int reserve) :
+ format_(format)
+{
+  if (reserve > 0)
+    text_.reserve(reserve);
+}
+
+std::string
+CMarkdownEmitter::
+takeText()
+{
+  std::string text;
+
+  std::swap(text, text_);
+
+  return text;
+}
+
+int64_t
+CMarkdownEmitter::
+flush(std::ostream &os)
+{
+  int64_t n = int64_t(text_.size());
+
+  os.write(text_.data(), std::streamsize(n));
+
+  flushed_ += int(n);
+
+  text_.clear();
+
+  return n;
+}
+
+int64_t
+CMarkdownEmitter::
+textBytes() const
+{
+  return int64_t(text_.size());
+}
+
+void
+CMarkdownEmitter::
+insert(int pos, const std::string &str)
+{
+  if (pos < flushed_ || pos > length())
+    return;
+
+  text_.insert(size_t(pos - flushed_), str);
+}
+
+void
+CMarkdownEmitter::
+reserve(int n)
+{
+  text_.reserve(n);
+}
+
+void
+CMarkdownEmitter::
+clear()
+{
+  text_.clear();
+
+  flushed_ = 0;
+
+  ttyBlocks_.clear();
+
+  noWrap_ = 0;
+
+  word_.clear();
+
+  wordWidth_  = 0;
+  col_        = 0;
+  indent_     = 0;
+  lineStart_  = true;
+  space_      = false;
+  blockStart_ = true;
+}
+
+//---
+
+void
+CMarkdownEmitter::
+raw(const std::string &str)
+{
+  if      (isHtml())
+    text_ += str;
+  else if (CMarkdownString::startsWith(str, "\033"))
+    ttyEscape(str);
+  else
+    ttyText(str.data(), int(str.size()), /*wrap*/false);
+}
+
+void
+CMarkdownEmitter::
+raw(char c)
+{
+  if (isHtml())
+    text_ += c;
+  else
+    ttyText(&c, 1, /*wrap*/false);
+}
+
+void
+CMarkdownEmitter::
+raw(const char *str)
+{
+  if (isHtml())
+    text_ += str;
+  else
+    raw(std::string(str));
+}
+
+void
+CMarkdownEmitter::
+newline()
+{
+  if (isHtml()) {
+    text_ += char('\n');
+    return;
+  }
+
+  ttyFlushWord();
+
+  // code block lines are always output (blank lines kept)
+  bool pre = (! ttyBlocks_.empty() && ttyBlocks_.back().type == CMarkdownTagType::PRE);
+
+  if (lineStart_ && pre)
+    ttyStartLine();
+
+  if (! lineStart_)
+    ttyEndLine();
+}
+
+void
+CMarkdownEmitter::
+lineBreak()
+{
+  if (isHtml()) {
+    text_ += "<br>\n";
+    return;
+  }
+
+  ttyFlushWord();
+
+  if (lineStart_)
+    ttyStartLine();
+
+  ttyEndLine();
+}
+
+//---
+
+void
+CMarkdownEmitter::
+text(const std::string &str)
+{
+  if (isHtml())
+    escapeText(str.data(), int(str.size()), Escape::TEXT);
+  else
+    ttyText(str.data(), int(str.size()), isTtyWrap());
+}
+
+void
+CMarkdownEmitter::
+text(const char *data, int len)
+{
+  if (isHtml())
+    escapeText(data, len, Escape::TEXT);
+  else
+    ttyText(data, len, isTtyWrap());
+}
+
+void
+CMarkdownEmitter::
+text(char c)
+{
+  if (isHtml()) {
+    if      (c == '<') text_ += "&lt;";
+    else if (c == '>') text_ += "&gt;";
+    else if (c == '"') text_ += "&quot;";
+    else if (c == '&') text_ += "&amp;";
+    else               text_ += c;
+  }
+  else
+    ttyText(&c, 1, isTtyWrap());
+}
+
+void
+CMarkdownEmitter::
+escapeText(const char *data, int len, Escape escape)
+{
+  // copy runs of unescaped characters in one append
+  int i = 0;
+
+  while (i < len) {
+    int i1 = i + findEscape(data + i, len - i, escape);
+
+    if (i1 > i)
+      text_.append(data + i, i1 - i);
+
+    if (i1 >= len)
+      break;
+
+    switch (data[i1]) {
+      case '<' : text_ += "&lt;"  ; break;
+      case '>' : text_ += "&gt;"  ; break;
+      case '"' : text_ += "&quot;"; break;
+      case '&' : text_ += "&amp;" ; break;
+      case '\'': text_ += "&#39;" ; break;
+      default  : break;
+    }
+
+    i = i1 + 1;
+  }
+}
+
+int
+CMarkdownEmitter::
+findEscape(const char *data, int len, Escape escape)
+{
+  int i = 0;
+
+#ifdef __SSE2__
+  // compare 16 bytes at a time against each escape character (bytes of multi-byte
+  // UTF-8 sequences never match)
+  const __m128i lt   = _mm_set1_epi8('<');
+  const __m128i gt   = _mm_set1_epi8('>');
+  const __m128i quot = _mm_set1_epi8('"');
+  const __m128i amp  = _mm_set1_epi8('&');
+  const __m128i apos = _mm_set1_epi8(escape == Escape::ATTR ? '\'' : '&');
+
+  for ( ; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+
+    __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, lt  ), _mm_cmpeq_epi8(v, gt )),
+                             _mm_or_si128(_mm_cmpeq_epi8(v, quot), _mm_cmpeq_epi8(v, amp)));
+
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, apos));
+
+    int mask = _mm_movemask_epi8(m);
+
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+#endif
+
+  return i + findEscapeScalar(data + i, len - i, escape);
+}
+
+int
+CMarkdownEmitter::
+findEscapeScalar(const char *data, int len, Escape escape)
+{
+  for (int i = 0; i < len; ++i) {
+    if (isEscapeChar(data[i], escape))
+      return i;
+  }
+
+  return len;
+}
+
+std::string
+CMarkdownEmitter::
+escapeString(const std::string &str, Escape escape)
+{
+  int len = int(str.size());
+
+  CMarkdownEmitter emitter(Format::HTML, len + 16);
+
+  emitter.escapeText(str.data(), len, escape);
+
+  return emitter.takeText();
+}
+
+std::string
+CMarkdownEmitter::
+encodeUrlPath(const std::string &path)
+{
+  static const char *hex = "0123456789ABCDEF";
+
+  std::string str;
+
+  str.reserve(path.size() + 16);
+
+  for (size_t i = 0; i < path.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(path[i]);
+
+    // unreserved, sub-delims and path separators are not encoded
+    bool keep = ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                 strchr("-._~!$&'()*+,;=:@/", c));
+
+    if (keep && c != 0)
+      str += char(c);
+    else {
+      str += char('%');
+      str += char(hex[c >> 4]);
+      str += char(hex[c & 0xf]);
+    }
+  }
+
+  return str;
+}
+
+std::string
+CMarkdownEmitter::
+fileUrl(const std::string &filename)
+{
+  if (filename == "")
+    return "";
+
+  std::string path = filename;
+
+#ifdef _WIN32
+  std::replace(path.begin(), path.end(), '\\', '/');
+#endif
+
+  // windows drive
+  if (path.size() > 1 && path[1] == ':' && path[0] != '/')
+    path = "/" + path;
+
+  // UNC path (//host/share) or absolute path
+  if      (CMarkdownString::startsWith(path, "//"))
+    return "file:" + encodeUrlPath(path);
+  else if (CMarkdownString::startsWith(path, "/"))
+    return "file://" + encodeUrlPath(path);
+  else
+    return "file:" + encodeUrlPath(path);
+}
+
+//---
+
+void
+CMarkdownEmitter::
+openTag(const char *name)
+{
+  if (! isHtml()) return;
+
+  text_ += char('<');
+  text_ += name;
+}
+
+void
+CMarkdownEmitter::
+openTag(const std::string &name)
+{
+  if (! isHtml()) return;
+
+  text_ += char('<');
+  text_ += name;
+}
+
+void
+CMarkdownEmitter::
+attr(const char *name, const std::string &value)
+{
+  if (! isHtml()) return;
+
+  text_ += char(' ');
+  text_ += name;
+  text_ += "=\"";
+
+  escapeText(value.data(), int(value.size()), Escape::ATTR);
+
+  text_ += char('"');
+}
+
+void
+CMarkdownEmitter::
+styleAttr(CMarkdownTagType type)
+{
+  if (! isHtml()) return;
+
+  const CMarkdownTagData &data = CMarkdown::getTagData(type);
+
+  if (data.color == "" && data.font == "")
+    return;
+
+  text_ += " style=\"";
+
+  if (data.color != "") {
+    text_ += "color:";
+    text_ += data.color;
+    text_ += char(';');
+  }
+
+  if (data.font != "") {
+    std::vector<std::string> fontParts = CMarkdownString::split(data.font, ':');
+
+    int np = int(fontParts.size());
+
+    if (np >= 1 && np <= 3) {
+      text_ += "font-family:";
+      text_ += fontParts[0];
+    }
+
+    if (np >= 2 && np <= 3) {
+      text_ += ";font-size:";
+      text_ += fontParts[1];
+      text_ += char(';');
+    }
+
+    if (np == 3) {
+      text_ += "font-style:";
+      text_ += fontParts[2];
+    }
+  }
+
+  text_ += char('"');
+}
+
+void
+CMarkdownEmitter::
+endOpenTag()
+{
+  if (! isHtml()) return;
+
+  text_ += char('>');
+}
+
+void
+CMarkdownEmitter::
+endEmptyTag()
+{
+  if (! isHtml()) return;
+
+  text_ += "/>";
+}
+
+void
+CMarkdownEmitter::
+closeTag(const char *name)
+{
+  if (! isHtml()) return;
+
+  text_ += "</";
+  text_ += name;
+  text_ += char('>');
+}
+
+void
+CMarkdownEmitter::
+closeTag(const std::string &name)
+{
+  if (! isHtml()) return;
+
+  text_ += "</";
+  text_ += name;
+  text_ += char('>');
+}
+
+//---
+
+void
+CMarkdownEmitter::
+startTag(CMarkdownTagType type)
+{
+  if (isHtml()) {
+    openTag(CMarkdown::getTagData(type).name);
+
+    styleAttr(type);
+
+    endOpenTag();
+  }
+  else {
+    ttyStartBlock(type);
+
+    ttyStartStyle(type);
+  }
+}
+
+void
+CMarkdownEmitter::
+endTag(CMarkdownTagType type)
+{
+  if (isHtml())
+    closeTag(CMarkdown::getTagData(type).name);
+  else {
+    ttyEndStyle(type);
+
+    ttyEndBlock(type);
+  }
+}
+
+void
+CMarkdownEmitter::
+fullTag(CMarkdownTagType type)
+{
+  if (isHtml()) {
+    openTag(CMarkdown::getTagData(type).name);
+
+    endEmptyTag();
+  }
+  else if (type == CMarkdownTagType::HR) {
+    ttyStartBlock(type);
+
+    ttyRule();
+
+    ttyEndBlock(type);
+  }
+}
+
+void
+CMarkdownEmitter::
+ttyStartStyle(CMarkdownTagType type)
+{
+  const std::string &color = CMarkdown::getTagData(type).color;
+
+  if      (color == "black"  ) raw("\033[30m");
+  else if (color == "red"    ) raw("\033[31m");
+  else if (color == "green"  ) raw("\033[32m");
+  else if (color == "yellow" ) raw("\033[33m");
+  else if (color == "blue"   ) raw("\033[34m");
+  else if (color == "magenta") raw("\033[35m");
+  else if (color == "cyan"   ) raw("\033[36m");
+  else if (color == "white"  ) raw("\033[37m");
+}
+
+void
+CMarkdownEmitter::
+ttyEndStyle(CMarkdownTagType type)
+{
+  const std::string &color = CMarkdown::getTagData(type).color;
+
+  if (color != "")
+    raw("\033[0m");
+}
+
+//---
+
+// add text to current line. Wrapped text is split into words at spaces and soft
+// line breaks and words are moved to the next line when past the output width.
+void
+CMarkdownEmitter::
+ttyText(const char *data, int len, bool wrap)
+{
+  for (int i = 0; i < len; ++i) {
+    char c = data[i];
+
+    if (wrap) {
+      if (c == ' ' || c == '\n' || c == '\t') {
+        ttyFlushWord();
+
+        if (! lineStart_)
+          space_ = true;
+      }
+      else {
+        word_ += c;
+
+        if (! CMarkdownString::isContinuation(c))
+          ++wordWidth_;
+      }
+    }
+    else {
+      ttyFlushWord();
+
+      if (lineStart_)
+        ttyStartLine();
+
+      if (c == '\n')
+        ttyEndLine();
+      else {
+        text_ += c;
+
+        if (! CMarkdownString::isContinuation(c))
+          ++col_;
+      }
+    }
+  }
+}
+
+// add escape sequence (no width)
+void
+CMarkdownEmitter::
+ttyEscape(const std::string &str)
+{
+  if (isTtyWrap())
+    word_ += str;
+  else
+    text_ += str;
+}
+
+void
+CMarkdownEmitter::
+ttyStartBlock(CMarkdownTagType type)
+{
+  if (! isTtyBlockType(type))
+    return;
+
+  ttyFlushWord();
+
+  if (! lineStart_)
+    ttyEndLine();
+
+  TtyBlock *parent = (! ttyBlocks_.empty() ? &ttyBlocks_.back() : nullptr);
+
+  auto isList = [](CMarkdownTagType type) {
+    return (type == CMarkdownTagType::UL || type == CMarkdownTagType::OL);
+  };
+
+  // nested list (in item or directly in list)
+  bool list   = isList(type);
+  bool nested = (list && parent && (parent->type == CMarkdownTagType::LI || isList(parent->type)));
+
+  // blank line between blocks (not between list items or before nested list)
+  bool separate = (type != CMarkdownTagType::LI && ! nested);
+
+  if (separate && ! blockStart_)
+    ttyBlankLine();
+
+  //---
+
+  TtyBlock block;
+
+  block.type = type;
+
+  if      (type == CMarkdownTagType::BLOCKQUOTE) {
+    block.first = "> ";
+    block.rest  = block.first;
+  }
+  else if (type == CMarkdownTagType::PRE) {
+    block.first = "    ";
+    block.rest  = block.first;
+  }
+  else if (type == CMarkdownTagType::LI) {
+    if (parent && parent->type == CMarkdownTagType::OL)
+      block.first = std::to_string(parent->number++) + ". ";
+    else
+      block.first = "\u2022 ";
+
+    block.rest = std::string(size_t(CMarkdownString::width(block.first)), ' ');
+  }
+  else if (list) {
+    // indent list nested directly in list to item text
+    if (nested && parent->type != CMarkdownTagType::LI) {
+      block.first = "  ";
+      block.rest  = block.first;
+    }
+
+    block.number = 1;
+  }
+
+  if (type == CMarkdownTagType::PRE || type == CMarkdownTagType::TABLE)
+    ++noWrap_;
+
+  ttyBlocks_.push_back(block);
+
+  blockStart_ = true;
+}
+
+void
+CMarkdownEmitter::
+ttyEndBlock(CMarkdownTagType type)
+{
+  if (! isTtyBlockType(type))
+    return;
+
+  ttyFlushWord();
+
+  if (! lineStart_)
+    ttyEndLine();
+
+  if (! ttyBlocks_.empty() && ttyBlocks_.back().type == type) {
+    if (type == CMarkdownTagType::PRE || type == CMarkdownTagType::TABLE)
+      --noWrap_;
+
+    ttyBlocks_.pop_back();
+  }
+
+  blockStart_ = false;
+}
+
+void
+CMarkdownEmitter::
+ttyStartCell()
+{
+  ttyFlushWord();
+
+  if (lineStart_)
+    ttyStartLine();
+
+  cellPos_ = int(text_.size());
+  cellCol_ = col_;
+}
+
+// pad cell output to width (padding before text for right and center align,
+// no trailing padding for last cell)
+int
+CMarkdownEmitter::
+ttyEndCell(int width, CMarkdown::Align align, bool last)
+{
+  ttyFlushWord();
+
+  int textWidth = col_ - cellCol_;
+
+  int pad = std::max(width - textWidth, 0);
+
+  int left = 0;
+
+  if      (align == CMarkdown::Align::RIGHT ) left = pad;
+  else if (align == CMarkdown::Align::CENTER) left = pad/2;
+
+  int right = (! last ? pad - left : 0);
+
+  if (left > 0)
+    text_.insert(size_t(cellPos_), size_t(left), ' ');
+
+  if (right > 0)
+    text_.append(size_t(right), ' ');
+
+  col_ += left + right;
+
+  return textWidth;
+}
+
+void
+CMarkdownEmitter::
+ttyCell(const std::string &text, int textWidth, int width, CMarkdown::Align align, bool last)
+{
+  ttyStartCell();
+
+  text_ += text;
+  col_  += textWidth;
+
+  (void) ttyEndCell(width, align, last);
+}
+
+// horizontal rule to output width
+void
+CMarkdownEmitter::
+ttyRule()
+{
+  ttyStartLine();
+
+  int width = (width_ > 0 ? width_ : 40) - col_;
+
+  for (int i = 0; i < std::max(width, 3); ++i)
+    text_ += "\u2500";
+
+  ttyEndLine();
+}
+
+// output pending word (on next line if past output width)
+void
+CMarkdownEmitter::
+ttyFlushWord()
+{
+  if (word_.empty())
+    return;
+
+  // escapes only (no line needed)
+  if (lineStart_ && wordWidth_ == 0) {
+    text_ += word_;
+
+    word_.clear();
+
+    return;
+  }
+
+  if      (lineStart_)
+    ttyStartLine();
+  else if (width_ > 0 && col_ > indent_ && col_ + (space_ ? 1 : 0) + wordWidth_ > width_) {
+    ttyEndLine();
+    ttyStartLine();
+  }
+
+  if (space_) {
+    text_ += char(' ');
+
+    ++col_;
+  }
+
+  text_ += word_;
+  col_  += wordWidth_;
+
+  word_.clear();
+
+  wordWidth_ = 0;
+  space_     = false;
+}
+
+// write line prefixes for current blocks
+void
+CMarkdownEmitter::
+ttyStartLine()
+{
+  for (auto &block : ttyBlocks_) {
+    const std::string &prefix = (block.started ? block.rest : block.first);
+
+    text_ += prefix;
+    col_  += CMarkdownString::width(prefix);
+
+    block.started = true;
+  }
+
+  indent_     = col_;
+  lineStart_  = false;
+  space_      = false;
+  blockStart_ = false;
+}
+
+void
+CMarkdownEmitter::
+ttyEndLine()
+{
+  text_ += char('\n');
+
+  col_       = 0;
+  indent_    = 0;
+  lineStart_ = true;
+  space_     = false;
+}
+
+// blank line with trimmed prefixes (e.g. quote marker)
+void
+CMarkdownEmitter::
+ttyBlankLine()
+{
+  std::string prefix;
+
+  for (const auto &block : ttyBlocks_)
+    prefix += (block.started ? block.rest : block.first);
+
+  size_t n = prefix.size();
+
+  while (n > 0 && prefix[n - 1] == ' ')
+    --n;
+
+  text_.append(prefix, 0, n);
+  text_ += char('\n');
+}
+
+bool
+CMarkdownEmitter::
+isTtyBlockType(CMarkdownTagType type)
+{
+  switch (type) {
+    case CMarkdownTagType::P:
+    case CMarkdownTagType::H1:
+    case CMarkdownTagType::H2:
+    case CMarkdownTagType::H3:
+    case CMarkdownTagType::H4:
+    case CMarkdownTagType::H5:
+    case CMarkdownTagType::H6:
+    case CMarkdownTagType::BLOCKQUOTE:
+    case CMarkdownTagType::UL:
+    case CMarkdownTagType::OL:
+    case CMarkdownTagType::LI:
+    case CMarkdownTagType::PRE:
+    case CMarkdownTagType::TABLE:
+    case CMarkdownTagType::HR:
+      return true;
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,379 @@
+#include <CMarkdownHighlight.h>
+#include <CMarkdownEmitter.h>
+#include <CMarkdownString.h>
+
+namespace {
+
+struct LanguageData {
+  using Languages = std::map<std::string,CMarkdownHighlight::Language>;
+  using Aliases   = std::map<std::string,std::string>;
+
+  Languages languages;
+  Aliases   aliases;
+};
+
+LanguageData &getLanguageData() {
+  static LanguageData data;
+
+  auto &languages = data.languages;
+
+  if (languages.empty()) {
+    using Language = CMarkdownHighlight::Language;
+
+    auto addLanguage = [&](const std::string &name, const std::string &aliasStr,
+                           const std::string &keywordStr, const std::string &typeStr,
+                           const std::string &lineCommentStr, const std::string &blockStart,
+                           const std::string &blockEnd, const std::string &quotes, bool preproc) {
+      Language language;
+
+      language.name = name;
+
+      for (const auto &word : CMarkdownString::split(keywordStr, ' '))
+        language.keywords.insert(word);
+
+      for (const auto &word : CMarkdownString::split(typeStr, ' '))
+        language.types.insert(word);
+
+      language.lineComments      = CMarkdownString::split(lineCommentStr, ' ');
+      language.blockCommentStart = blockStart;
+      language.blockCommentEnd   = blockEnd;
+      language.quotes            = quotes;
+      language.preproc           = preproc;
+
+      languages[name] = language;
+
+      data.aliases[name] = name;
+
+      for (const auto &alias : CMarkdownString::split(aliasStr, ' '))
+        data.aliases[alias] = name;
+    };
+
+    //---
+
+    addLanguage("cpp", "c c++ cxx cc h hpp",
+      "if else for while do switch case default break continue return goto "
+      "class struct union enum namespace using typedef template typename public "
+      "private protected virtual override final static const constexpr inline "
+      "extern friend operator new delete this sizeof try catch throw nullptr true "
+      "false explicit mutable volatile auto decltype noexcept static_cast "
+      "dynamic_cast const_cast reinterpret_cast",
+      "void bool char short int long float double signed unsigned size_t wchar_t "
+      "int8_t int16_t int32_t int64_t uint8_t uint16_t uint32_t uint64_t",
+      "//", "/*", "*/", "\"'", true);
+
+    addLanguage("java", "",
+      "if else for while do switch case default break continue return class "
+      "interface enum extends implements package import public private protected "
+      "static final abstract synchronized native transient volatile new this super "
+      "try catch finally throw throws instanceof true false null",
+      "void boolean byte char short int long float double String Object",
+      "//", "/*", "*/", "\"'", false);
+
+    addLanguage("javascript", "js typescript ts jsx tsx",
+      "if else for while do switch case default break continue return function "
+      "class extends new this super var let const try catch finally throw typeof "
+      "instanceof in of import export from as async await yield true false null "
+      "undefined interface type",
+      "number string boolean any void never unknown object",
+      "//", "/*", "*/", "\"'`", false);
+
+    addLanguage("python", "py python3",
+      "if elif else for while break continue return def class lambda import from "
+      "as with try except finally raise pass yield global nonlocal del assert in "
+      "is not and or True False None async await",
+      "int float str bool list dict set tuple bytes object",
+      "#", "", "", "\"'", false);
+
+    addLanguage("sh", "bash shell zsh csh console",
+      "if then else elif fi for while until do done case esac in function return "
+      "exit export local set unset echo source alias foreach end endif",
+      "",
+      "#", "", "", "\"'", false);
+
+    addLanguage("rust", "rs",
+      "fn let mut const static if else match for while loop break continue return "
+      "struct enum impl trait type use mod pub crate self Self super where as ref "
+      "move unsafe async await dyn true false",
+      "i8 i16 i32 i64 i128 isize u8 u16 u32 u64 u128 usize f32 f64 bool char str "
+      "String Vec Option Result Box",
+      "//", "/*", "*/", "\"", false);
+
+    addLanguage("go", "golang",
+      "func var const type struct interface map chan if else for range switch case "
+      "default break continue return go defer select package import fallthrough "
+      "goto true false nil",
+      "bool byte rune int int8 int16 int32 int64 uint uint8 uint16 uint32 uint64 "
+      "float32 float64 string error",
+      "//", "/*", "*/", "\"'`", false);
+
+    addLanguage("tcl", "",
+      "proc set if elseif else for foreach while switch return break continue "
+      "global upvar variable namespace eval expr puts incr append lappend list "
+      "catch error",
+      "",
+      "#", "", "", "\"", false);
+
+    addLanguage("json", "",
+      "true false null", "", "", "", "", "\"", false);
+  }
+
+  return data;
+}
+
+// check for string match at position
+inline bool matchAt(const std::string &str, int i, const std::string &match) {
+  int len = int(match.size());
+
+  if (len == 0 || i + len > int(str.size()))
+    return false;
+
+  for (int j = 0; j < len; ++j)
+    if (str[i + j] != match[j])
+      return false;
+
+  return true;
+}
+
+inline bool isIdentChar(char c) {
+  return (CMarkdownString::isAlnum(c) || c == '_');
+}
+
+// check for only spaces between start of line and position
+inline bool isLineStart(const char *data, int i) {
+  --i;
+
+  while (i >= 0 && data[i] != '\n' && CMarkdownString::isSpace(data[i]))
+    --i;
+
+  return (i < 0 || data[i] == '\n');
+}
+
+}
+
+//---
+
+CMarkdownHighlight::
+CMarkdownHighlight()
+{
+}
+
+const CMarkdownHighlight::Language *
+CMarkdownHighlight::
+getLanguage(const std::string &name)
+{
+  const LanguageData &data = getLanguageData();
+
+  auto pa = data.aliases.find(CMarkdownString::toLower(name));
+
+  if (pa == data.aliases.end())
+    return nullptr;
+
+  auto pl = data.languages.find((*pa).second);
+
+  if (pl == data.languages.end())
+    return nullptr;
+
+  return &(*pl).second;
+}
+
+bool
+CMarkdownHighlight::
+highlight(const std::string &lang, const std::string &code, CMarkdownEmitter &emitter)
+{
+  const Language *language = getLanguage(lang);
+
+  if (! language)
+    return false;
+
+  Key key;
+
+  key.lang = language->name;
+  key.hash = CMarkdownString::hashString(code);
+  key.len  = int(code.size());
+
+  auto p = cache_.find(key);
+
+  if (p == cache_.end()) {
+    int len = int(code.size());
+
+    CMarkdownEmitter emitter1(emitter.format(), len + len/2);
+
+    tokenize(*language, code, emitter1);
+
+    Entry entry;
+
+    entry.html = emitter1.takeText();
+
+    p = cache_.insert(p, Cache::value_type(key, entry));
+  }
+
+  (*p).second.pass = pass_;
+
+  emitter.raw((*p).second.html);
+
+  return true;
+}
+
+void
+CMarkdownHighlight::
+startPass()
+{
+  ++pass_;
+}
+
+void
+CMarkdownHighlight::
+endPass()
+{
+  for (auto p = cache_.begin(); p != cache_.end(); ) {
+    if ((*p).second.pass != pass_)
+      p = cache_.erase(p);
+    else
+      ++p;
+  }
+}
+
+void
+CMarkdownHighlight::
+clear()
+{
+  cache_.clear();
+}
+
+void
+CMarkdownHighlight::
+tokenize(const Language &language, const std::string &code, CMarkdownEmitter &emitter) const
+{
+  const char *data = code.data();
+
+  int len = int(code.size());
+
+  auto emitToken = [&](TokenType type, int i1, int i2) {
+    emitter.raw("<span style=\"color:");
+    emitter.raw(tokenColor(type));
+    emitter.raw("\">");
+
+    emitter.text(data + i1, i2 - i1);
+
+    emitter.raw("</span>");
+  };
+
+  //---
+
+  int i  = 0;
+  int i1 = 0; // start of pending plain text
+
+  auto flushText = [&](int i2) {
+    if (i2 > i1)
+      emitter.text(data + i1, i2 - i1);
+  };
+
+  while (i < len) {
+    char c = data[i];
+
+    int       istart = i;
+    TokenType type   = TokenType::NONE;
+
+    // block comment
+    if      (matchAt(code, i, language.blockCommentStart)) {
+      i += int(language.blockCommentStart.size());
+
+      while (i < len && ! matchAt(code, i, language.blockCommentEnd))
+        ++i;
+
+      if (i < len)
+        i += int(language.blockCommentEnd.size());
+
+      type = TokenType::COMMENT;
+    }
+    // preprocessor directive
+    else if (language.preproc && c == '#' && isLineStart(data, i)) {
+      while (i < len && data[i] != '\n')
+        ++i;
+
+      type = TokenType::PREPROC;
+    }
+    // string
+    else if (CMarkdownString::indexOf(language.quotes, c) >= 0) {
+      ++i;
+
+      while (i < len && data[i] != c) {
+        // strings end at line end (except for template strings)
+        if (data[i] == '\n' && c != '`')
+          break;
+
+        if (data[i] == '\\' && i < len - 1)
+          ++i;
+
+        ++i;
+      }
+
+      if (i < len && data[i] == c)
+        ++i;
+
+      type = TokenType::STRING;
+    }
+    // number
+    else if (CMarkdownString::isDigit(c) && (istart == 0 || ! isIdentChar(data[istart - 1]))) {
+      while (i < len && (isIdentChar(data[i]) || data[i] == '.'))
+        ++i;
+
+      type = TokenType::NUMBER;
+    }
+    // keyword, type or identifier
+    else if (CMarkdownString::isAlpha(c) || c == '_') {
+      while (i < len && isIdentChar(data[i]))
+        ++i;
+
+      std::string word(data + istart, size_t(i - istart));
+
+      if      (language.keywords.find(word) != language.keywords.end())
+        type = TokenType::KEYWORD;
+      else if (language.types.find(word) != language.types.end())
+        type = TokenType::TYPE;
+    }
+    else {
+      // line comment
+      for (const auto &lineComment : language.lineComments) {
+        if (matchAt(code, i, lineComment)) {
+          while (i < len && data[i] != '\n')
+            ++i;
+
+          type = TokenType::COMMENT;
+
+          break;
+        }
+      }
+
+      if (type == TokenType::NONE)
+        ++i;
+    }
+
+    //---
+
+    if (type != TokenType::NONE) {
+      flushText(istart);
+
+      emitToken(type, istart, i);
+
+      i1 = i;
+    }
+  }
+
+  flushText(len);
+}
+
+const char *
+CMarkdownHighlight::
+tokenColor(TokenType type)
+{
+  switch (type) {
+    case TokenType::KEYWORD: return "#0000c0";
+    case TokenType::TYPE   : return "#2b91af";
+    case TokenType::STRING : return "#a31515";
+    case TokenType::NUMBER : return "#098658";
+    case TokenType::COMMENT: return "#008000";
+    case TokenType::PREPROC: return "#800080";
+    default                : return "#000000";
+  }
+}
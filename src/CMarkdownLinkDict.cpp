@@ -0,0 +1,338 @@
+#include <CMarkdownLinkDict.h>
+#include <CMarkdownString.h>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// dictionary layout (native byte order, magic fails to match on other byte order):
+//   Header
+//   Entry    entries[numEntries]
+//   uint32_t buckets[numBuckets] (entry index + 1, 0 for empty)
+//   char     strings[]           (UTF-8, offsets relative to start of strings)
+struct CMarkdownLinkDict::Header {
+  uint32_t magic      { 0 };
+  uint32_t version    { 0 };
+  uint32_t numEntries { 0 };
+  uint32_t numBuckets { 0 }; // power of two, more than numEntries
+  uint64_t strings    { 0 }; // offset of string pool
+  uint64_t size       { 0 }; // total size
+};
+
+struct CMarkdownLinkDict::Entry {
+  uint64_t hash     { 0 };   // hash of key
+  uint32_t key      { 0 };   // lower case reference
+  uint32_t keyLen   { 0 };
+  uint32_t ref      { 0 };   // reference as defined
+  uint32_t refLen   { 0 };
+  uint32_t dest     { 0 };
+  uint32_t destLen  { 0 };
+  uint32_t title    { 0 };
+  uint32_t titleLen { 0 };
+};
+
+namespace {
+
+const uint32_t dictMagic   = 0x444c4d43; // "CMLD"
+const uint32_t dictVersion = 1;
+
+}
+
+//---
+
+CMarkdownLinkDict::
+CMarkdownLinkDict()
+{
+}
+
+CMarkdownLinkDict::
+~CMarkdownLinkDict()
+{
+  clear();
+}
+
+void
+CMarkdownLinkDict::
+clear()
+{
+  if (mapped_)
+    munmap(const_cast<char *>(data_), size_);
+
+  buffer_.clear();
+
+  data_   = nullptr;
+  size_   = 0;
+  mapped_ = false;
+}
+
+bool
+CMarkdownLinkDict::
+load(const std::string &filename)
+{
+  clear();
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  size_t size = size_t(st.st_size);
+
+  // compiled dictionary is mapped (mapping kept after file closed)
+  uint32_t magic = 0;
+
+  if (size >= sizeof(Header) && ::read(fd, &magic, sizeof(magic)) == sizeof(magic) &&
+      magic == dictMagic) {
+    void *p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+    ::close(fd);
+
+    if (p == MAP_FAILED)
+      return false;
+
+    mapped_ = true;
+
+    if (! setData(static_cast<const char *>(p), size)) {
+      munmap(p, size);
+
+      mapped_ = false;
+
+      return false;
+    }
+
+    return true;
+  }
+
+  ::close(fd);
+
+  // markdown definitions are parsed
+  std::ifstream is(filename, std::ios::binary);
+
+  std::stringstream ss;
+
+  ss << is.rdbuf();
+
+  if (is.bad())
+    return false;
+
+  build(ss.str());
+
+  return true;
+}
+
+void
+CMarkdownLinkDict::
+build(const std::string &text)
+{
+  clear();
+
+  // collect definitions (same parse as document definitions)
+  using Links = std::map<std::string,LinkRef>;
+
+  Links links;
+
+  int len = int(text.size());
+
+  for (int i = 0; i < len; ) {
+    int j = CMarkdownString::indexOf(text, '\n', i);
+
+    if (j < 0)
+      j = len;
+
+    std::string line = CMarkdownString::mid(text, i, j - i);
+
+    if (CMarkdownString::endsWith(line, "\r"))
+      line.pop_back();
+
+    LinkRef link;
+    int     istart, iend;
+
+    if (CMarkdownParse::isLinkReference(line, link, istart, iend))
+      links[CMarkdownString::toLower(link.ref)] = link;
+
+    i = j + 1;
+  }
+
+  //---
+
+  // size table for load factor of at most one half
+  uint32_t numEntries = uint32_t(links.size());
+  uint32_t numBuckets = 8;
+
+  while (numBuckets < 2*numEntries)
+    numBuckets *= 2;
+
+  std::vector<Entry>    entries;
+  std::vector<uint32_t> buckets(numBuckets, 0);
+  std::string           strings;
+
+  entries.reserve(numEntries);
+
+  auto addString = [&](const std::string &str, uint32_t &pos, uint32_t &len) {
+    pos = uint32_t(strings.size());
+    len = uint32_t(str.size());
+
+    strings += str;
+  };
+
+  for (const auto &p : links) {
+    Entry entry;
+
+    entry.hash = CMarkdownString::hashString(p.first);
+
+    addString(p.first       , entry.key  , entry.keyLen  );
+    addString(p.second.ref  , entry.ref  , entry.refLen  );
+    addString(p.second.dest , entry.dest , entry.destLen );
+    addString(p.second.title, entry.title, entry.titleLen);
+
+    uint32_t b = uint32_t(entry.hash) & (numBuckets - 1);
+
+    while (buckets[b] != 0)
+      b = (b + 1) & (numBuckets - 1);
+
+    entries.push_back(entry);
+
+    buckets[b] = uint32_t(entries.size());
+  }
+
+  //---
+
+  Header header;
+
+  header.magic      = dictMagic;
+  header.version    = dictVersion;
+  header.numEntries = numEntries;
+  header.numBuckets = numBuckets;
+  header.strings    = sizeof(Header) + numEntries*sizeof(Entry) + numBuckets*sizeof(uint32_t);
+  header.size       = header.strings + strings.size();
+
+  buffer_.reserve(header.size);
+
+  buffer_.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  buffer_.append(reinterpret_cast<const char *>(entries.data()), numEntries*sizeof(Entry));
+  buffer_.append(reinterpret_cast<const char *>(buckets.data()), numBuckets*sizeof(uint32_t));
+  buffer_.append(strings);
+
+  (void) setData(buffer_.data(), buffer_.size());
+}
+
+bool
+CMarkdownLinkDict::
+save(const std::string &filename) const
+{
+  if (! data_)
+    return false;
+
+  std::ofstream os(filename, std::ios::binary);
+
+  if (! os)
+    return false;
+
+  os.write(data_, std::streamsize(size_));
+
+  return bool(os);
+}
+
+// set dictionary data (checked against header)
+bool
+CMarkdownLinkDict::
+setData(const char *data, size_t size)
+{
+  if (size < sizeof(Header))
+    return false;
+
+  const Header *header = reinterpret_cast<const Header *>(data);
+
+  if (header->magic != dictMagic || header->version != dictVersion)
+    return false;
+
+  uint32_t nb = header->numBuckets;
+
+  if (nb == 0 || (nb & (nb - 1)) != 0 || header->numEntries >= nb)
+    return false;
+
+  uint64_t strings = sizeof(Header) + uint64_t(header->numEntries)*sizeof(Entry) +
+                     uint64_t(nb)*sizeof(uint32_t);
+
+  if (header->strings != strings || header->size < strings || header->size > size)
+    return false;
+
+  data_ = data;
+  size_ = size;
+
+  return true;
+}
+
+int
+CMarkdownLinkDict::
+numLinks() const
+{
+  if (! data_)
+    return 0;
+
+  return int(reinterpret_cast<const Header *>(data_)->numEntries);
+}
+
+bool
+CMarkdownLinkDict::
+getLink(const std::string &ref, LinkRef &link) const
+{
+  if (! data_)
+    return false;
+
+  const Header *header  = reinterpret_cast<const Header *>(data_);
+  const Entry  *entries = reinterpret_cast<const Entry *>(data_ + sizeof(Header));
+  const auto   *buckets = reinterpret_cast<const uint32_t *>(entries + header->numEntries);
+  const char   *strings = data_ + header->strings;
+
+  uint64_t nstrings = header->size - header->strings;
+
+  // string in pool (empty if out of range)
+  auto getString = [&](uint32_t pos, uint32_t len) {
+    if (uint64_t(pos) + len > nstrings)
+      return std::string();
+
+    return std::string(strings + pos, len);
+  };
+
+  std::string key = CMarkdownString::toLower(ref);
+
+  uint64_t hash = CMarkdownString::hashString(key);
+
+  uint32_t mask = header->numBuckets - 1;
+
+  // probe ends at empty bucket (at most all buckets checked for bad file)
+  uint32_t b = uint32_t(hash) & mask;
+
+  for (uint32_t n = 0; n < header->numBuckets && buckets[b] != 0; ++n, b = (b + 1) & mask) {
+    if (buckets[b] > header->numEntries)
+      return false;
+
+    const Entry &entry = entries[buckets[b] - 1];
+
+    if (entry.hash != hash || entry.keyLen != key.size() ||
+        uint64_t(entry.key) + entry.keyLen > nstrings ||
+        memcmp(strings + entry.key, key.data(), key.size()) != 0)
+      continue;
+
+    link.ref   = getString(entry.ref  , entry.refLen  );
+    link.dest  = getString(entry.dest , entry.destLen );
+    link.title = getString(entry.title, entry.titleLen);
+
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,147 @@
+#include <CMarkdownTrace.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+bool CMarkdownTrace::enabled_ = false;
+
+namespace {
+
+// write JSON string value (UTF-8)
+void writeString(std::ostream &os, const std::string &str) {
+  os << "\"";
+
+  for (const auto &c : str) {
+    if      (c == '"' || c == '\\')
+      os << '\\' << c;
+    else if (c >= 0 && c < ' ') {
+      char buffer[8];
+
+      snprintf(buffer, sizeof(buffer), "\\u%04x", int(c));
+
+      os << buffer;
+    }
+    else
+      os << c;
+  }
+
+  os << "\"";
+}
+
+}
+
+//---
+
+CMarkdownTrace &
+CMarkdownTrace::
+instance()
+{
+  static CMarkdownTrace trace;
+
+  return trace;
+}
+
+int64_t
+CMarkdownTrace::
+now()
+{
+  using Clock = std::chrono::steady_clock;
+
+  static Clock::time_point start = Clock::now();
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+void
+CMarkdownTrace::
+complete(const char *cat, const std::string &name, int64_t ts, const std::string &detail)
+{
+  Event event;
+
+  event.cat    = cat;
+  event.name   = name;
+  event.ph     = 'X';
+  event.ts     = ts;
+  event.dur    = now() - ts;
+  event.detail = detail;
+
+  events_.push_back(event);
+}
+
+void
+CMarkdownTrace::
+instant(const char *cat, const std::string &name, const std::string &detail)
+{
+  Event event;
+
+  event.cat    = cat;
+  event.name   = name;
+  event.ph     = 'i';
+  event.ts     = now();
+  event.detail = detail;
+
+  events_.push_back(event);
+}
+
+void
+CMarkdownTrace::
+clear()
+{
+  events_.clear();
+}
+
+void
+CMarkdownTrace::
+write(std::ostream &os) const
+{
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+  int n = 0;
+
+  for (const auto &event : events_) {
+    if (n++ > 0)
+      os << ",\n";
+
+    // times in microseconds
+    os << "{\"name\":";
+
+    writeString(os, event.name);
+
+    os << ",\"cat\":\"" << event.cat << "\"," <<
+          "\"ph\":\"" << event.ph << "\",\"ts\":" << event.ts/1000.0 << ",";
+
+    if (event.ph == 'X')
+      os << "\"dur\":" << event.dur/1000.0 << ",";
+    else
+      os << "\"s\":\"t\",";
+
+    os << "\"pid\":1,\"tid\":1";
+
+    if (! event.detail.empty()) {
+      os << ",\"args\":{\"detail\":";
+
+      writeString(os, event.detail);
+
+      os << "}";
+    }
+
+    os << "}";
+  }
+
+  os << "\n]}\n";
+}
+
+bool
+CMarkdownTrace::
+save(const std::string &filename) const
+{
+  std::ofstream os(filename);
+
+  if (! os)
+    return false;
+
+  write(os);
+
+  return bool(os);
+}
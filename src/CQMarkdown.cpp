@@ -79,7 +79,7 @@ saveHtml(const QString &fileName)
 
   QTextStream outStream(&file);
 
-  outStream << preview_->html();
+  outStream << preview_->fullHtml();
 
   file.close();
 
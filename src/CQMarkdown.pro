@@ -2,7 +2,7 @@ TEMPLATE = lib
 
 TARGET = CQMarkdown
 
-QT += widgets
+QT += widgets concurrent
 
 DEPENDPATH += .
 
@@ -12,17 +12,22 @@ MOC_DIR = .moc
 
 CONFIG += staticlib
 
+# widgets (converter is in CMarkdown library, see CMarkdown.pro)
 SOURCES += \
-CMarkdown.cpp \
 CQMarkdown.cpp \
 CQMarkdownEdit.cpp \
+CQMarkdownImageCache.cpp \
+CQMarkdownOutline.cpp \
 CQMarkdownPreview.cpp \
+CQMarkdownRefRenderer.cpp \
 
 HEADERS += \
-../include/CMarkdown.h \
 ../include/CQMarkdownEdit.h \
+../include/CQMarkdownImageCache.h \
 ../include/CQMarkdown.h \
+../include/CQMarkdownOutline.h \
 ../include/CQMarkdownPreview.h \
+../include/CQMarkdownRefRenderer.h \
 
 DESTDIR     = ../lib
 OBJECTS_DIR = ../obj
@@ -32,5 +37,4 @@ INCLUDEPATH += \
 . \
 ../include \
 ../../CQUtil/include \
-../../CCommand/include \
 ../../CUtil/include \
@@ -1,11 +1,16 @@
 #include <CQMarkdownEdit.h>
 #include <CQMarkdown.h>
+#include <CQMarkdownPreview.h>
 #include <CMarkdown.h>
 #include <CQStrParse.h>
 
 #include <QSyntaxHighlighter>
 #include <QToolButton>
 #include <QVBoxLayout>
+#include <QScrollBar>
+#include <QMimeData>
+#include <QTextBlock>
+#include <QElapsedTimer>
 #include <QTimer>
 
 #include <svg/normal_svg.h>
@@ -26,6 +31,19 @@
 #include <svg/image_svg.h>
 
 namespace {
+  // text with more lines than this is highlighted in time slices
+  const int deferLines = 2000;
+
+  // max time (ns) spent highlighting per event loop turn
+  const qint64 sliceTime = 5000000;
+
+  // preview update delay range (ms)
+  const int minUpdateDelay = 10;
+  const int maxUpdateDelay = 1000;
+
+  // min time (ms) before pending preview update is no longer delayed by edits
+  const int minPendingTime = 500;
+
   QStringList stringToLines(const QString &text) {
     QString text1 = text;
 
@@ -35,161 +53,279 @@ namespace {
   }
 }
 
+// Editor syntax highlighter.
+//
+// Lines are classified by the shared markdown line classifier. Code fence, list and
+// quote context is stored in the QTextBlock user state so QSyntaxHighlighter only
+// continues to rehighlight following blocks while their state changes.
+//
+// For large loads and pastes highlighting is deferred: visible blocks are highlighted
+// first and the rest in short idle time slices from the first changed block.
 class CQMarkdownEditSyntaxHighlight : public QSyntaxHighlighter {
  public:
-  struct StyleIndices {
-    int  start  { 0 };
-    int  len    { 0 };
-    bool bold   { false };
-    bool italic { false };
-    bool strike { false };
-
-    StyleIndices(int start1=0, int len1=0) :
-     start(start1), len(len1) {
-    }
+  enum StyleFlag {
+    ITALIC = (1<<0),
+    BOLD   = (1<<1),
+    STRIKE = (1<<2),
+    CODE   = (1<<3)
   };
 
-  typedef std::vector<StyleIndices> StyleIndicesList;
+  using LineType    = CMarkdownParse::LineType;
+  using LineContext = CMarkdownParse::LineContext;
+  using StyleFlags  = std::vector<uchar>;
 
  public:
   CQMarkdownEditSyntaxHighlight(CQMarkdownEditText *text) :
    QSyntaxHighlighter(text->document()), text_(text) {
+    timer_ = new QTimer(this);
+
+    timer_->setSingleShot(true);
+
+    connect(timer_, &QTimer::timeout, this, [this]() { highlightSlice(); });
+
+    connect(text_->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, [this]() { highlightVisible(); });
   }
 
   CQMarkdownEditText *text() const { return text_; }
 
-  void highlightBlock(const QString &str) override {
-    CMarkdownBlock::ATXData atxData;
-    CMarkdown::LinkRef      linkRef;
-    int                     istart, iend;
+  //! defer highlighting of blocks from start block (highlighted in time slices)
+  void startDeferred(int startBlock) {
+    if (deferred_)
+      startBlock = std::min(startBlock, frontier_ + 1);
 
-    if      (CMarkdownParse::isATXHeader(str, atxData, istart, iend)) {
-      QTextCharFormat fmt;
+    deferred_     = true;
+    frontier_     = startBlock - 1;
+    visibleStart_ = -1;
+    visibleEnd_   = -1;
 
-      fmt.setFontWeight(QFont::Bold);
+    timer_->start(0);
+  }
 
-      setFormat(istart, iend - istart + 1, fmt);
+  void highlightBlock(const QString &str) override {
+    // skip blocks not yet reached by deferred highlight (keep state so
+    // rehighlight does not continue to next block)
+    if (deferred_) {
+      int n = currentBlock().blockNumber();
+
+      if (n > frontier_ && (n < visibleStart_ || n > visibleEnd_)) {
+        setCurrentBlockState(currentBlockState());
+        return;
+      }
     }
-    else if (CMarkdownParse::isLinkReference(str, linkRef, istart, iend)) {
-      QTextCharFormat fmt;
 
-      fmt.setForeground(QColor(0,0,255));
+    LineContext context = LineContext::fromState(previousBlockState());
 
-      setFormat(istart, iend - istart + 1, fmt);
-    }
-    else if (CMarkdownParse::isRule(str, istart, iend)) {
-      QTextCharFormat fmt;
+    std::string utf8 = str.toStdString();
 
-      fmt.setForeground(QColor(128,128,128));
+    LineType type = CMarkdownParse::classifyLine(utf8, context);
 
-      setFormat(istart, iend - istart + 1, fmt);
-    }
-    else {
-      StyleIndicesList indicesList;
+    setCurrentBlockState(context.toState());
 
-      getStyleIndices(str, indicesList, StyleIndices());
+    //---
 
-      for (const auto &indices : indicesList) {
+    switch (type) {
+      case LineType::HEADER: {
         QTextCharFormat fmt;
 
-        if (indices.italic)
-          fmt.setFontItalic(true);
+        fmt.setFontWeight(QFont::Bold);
+
+        setFormat(0, str.length(), fmt);
+
+        break;
+      }
+      case LineType::LINK_REF: {
+        QTextCharFormat fmt;
 
-        if (indices.bold)
-          fmt.setFontWeight(QFont::Bold);
+        fmt.setForeground(QColor(0,0,255));
 
-        if (indices.strike)
-          fmt.setFontStrikeOut(true);
+        setFormat(0, str.length(), fmt);
 
-        setFormat(indices.start, indices.len, fmt);
+        break;
       }
+      case LineType::RULE:
+      case LineType::FENCE: {
+        QTextCharFormat fmt;
+
+        fmt.setForeground(QColor(128,128,128));
+
+        setFormat(0, str.length(), fmt);
+
+        break;
+      }
+      case LineType::CODE: {
+        setFormat(0, str.length(), codeFormat());
+
+        break;
+      }
+      case LineType::TEXT:
+      case LineType::QUOTE:
+      case LineType::LIST_ITEM:
+      case LineType::TABLE: {
+        highlightInline(utf8);
+
+        break;
+      }
+      default:
+        break;
     }
   }
 
-  void getStyleIndices(const QString &str, StyleIndicesList &indicesList,
-                       const StyleIndices &parentIndices) {
-    int i   = 0;
-    int len = str.length();
+ private:
+  // highlight visible blocks during deferred highlight
+  void highlightVisible() {
+    if (! deferred_)
+      return;
+
+    QWidget *viewport = text_->viewport();
 
-    while (i < len) {
-      // emphasis
-      if (str[i] == '*' || str[i] == '_') {
-        int istart = i;
+    QTextBlock block1 = text_->cursorForPosition(QPoint(0, 0)).block();
+    QTextBlock block2 = text_->cursorForPosition(
+                          QPoint(viewport->width() - 1, viewport->height() - 1)).block();
 
-        QString str1;
-        int     start1;
+    visibleStart_ = block1.blockNumber();
+    visibleEnd_   = block2.blockNumber();
 
-        int nc = CMarkdownParse::parseSurroundText(str, i, str1, start1);
+    for (QTextBlock block = block1; block.isValid(); block = block.next()) {
+      if (block.blockNumber() > visibleEnd_)
+        break;
 
-        if (nc > 0) {
-          StyleIndices indices = parentIndices;
+      if (block.blockNumber() > frontier_)
+        rehighlightBlock(block);
+    }
+  }
 
-          indices.start = istart;
-          indices.len   = i - istart + 1;
+  // highlight next blocks for up to slice time
+  void highlightSlice() {
+    if (! deferred_)
+      return;
 
-          if (nc == 1)
-            indices.italic = true;
-          else
-            indices.bold = true;
+    if (visibleStart_ < 0)
+      highlightVisible();
 
-          indicesList.push_back(indices);
+    QElapsedTimer timer;
 
-          //---
+    timer.start();
 
-          StyleIndicesList indicesList1;
+    QTextBlock block = document()->findBlockByNumber(frontier_ + 1);
 
-          getStyleIndices(str1, indicesList1, indices);
+    while (block.isValid() && timer.nsecsElapsed() < sliceTime) {
+      frontier_ = block.blockNumber();
 
-          for (auto &indices1 : indicesList1) {
-            indices1.start += start1;
+      rehighlightBlock(block);
 
-            indicesList.push_back(indices1);
-          }
-        }
-        else
-          ++i;
-      }
-      // code block
-      else if (i < len - 1 && str[i] == '~' && str[i + 1] == '~') {
-        int istart = i;
+      block = block.next();
+    }
 
-        QString str1;
-        int     start1;
+    if (block.isValid())
+      timer_->start(0);
+    else
+      deferred_ = false;
+  }
+
+  // set emphasis, strike and code span formats (styles found on UTF-8 bytes, formats
+  // set on UTF-16 positions of block text)
+  void highlightInline(const std::string &str) {
+    int len = int(str.size());
+
+    flags_.assign(len, 0);
+
+    styleRange(str, 0, len);
+
+    // set format for runs of same style
+    int i = 0, pos = 0;
+
+    while (i < len) {
+      uchar flags = flags_[i];
+
+      int pos1 = pos;
 
-        int nc = CMarkdownParse::parseSurroundText(str, i, str1, start1);
+      while (i < len && flags_[i] == flags)
+        pos += utf16Len(str[i++]);
 
-        if (nc > 1) {
-          StyleIndices indices = parentIndices;
+      if (! flags)
+        continue;
 
-          indices.start = istart;
-          indices.len   = i - istart + 1;
+      QTextCharFormat fmt;
 
-          indices.strike = true;
+      if (flags & CODE)
+        fmt = codeFormat();
 
-          indicesList.push_back(indices);
+      if (flags & ITALIC)
+        fmt.setFontItalic(true);
 
-          //---
+      if (flags & BOLD)
+        fmt.setFontWeight(QFont::Bold);
 
-          StyleIndicesList indicesList1;
+      if (flags & STRIKE)
+        fmt.setFontStrikeOut(true);
 
-          getStyleIndices(str1, indicesList1, indices);
+      setFormat(pos1, pos - pos1, fmt);
+    }
+  }
 
-          for (auto &indices1 : indicesList1) {
-            indices1.start += start1;
+  // number of UTF-16 code units added by UTF-8 byte (surrogate pair for four
+  // byte sequence, none for continuation bytes)
+  static int utf16Len(char c) {
+    uchar uc = uchar(c);
 
-            indicesList.push_back(indices1);
-          }
-        }
-        else
-          ++i;
+    return (uc >= 0xF0 ? 2 : ((uc & 0xC0) == 0x80 ? 0 : 1));
+  }
+
+  // add style flags for surrounded text in range (nested spans use inner range)
+  void styleRange(const std::string &str, int i, int end) {
+    while (i < end) {
+      char c = str[i];
+
+      if (c == '\\' && i < end - 1) {
+        i += 2;
+        continue;
       }
-      else
+
+      bool strike = (c == '~' && i < end - 1 && str[i + 1] == '~');
+
+      if (c != '*' && c != '_' && c != '`' && ! strike) {
         ++i;
+        continue;
+      }
+
+      int i1 = i;
+
+      int nc = CMarkdownParse::skipSurroundText(str, i, c, end);
+
+      if (nc == 0 || (strike && nc < 2)) {
+        i = i1 + 1;
+        continue;
+      }
+
+      uchar flag = (c == '`' ? CODE : (strike ? STRIKE : (nc == 1 ? ITALIC : BOLD)));
+
+      for (int j = i1; j < i; ++j)
+        flags_[j] |= flag;
+
+      // no styles inside code span
+      if (c != '`')
+        styleRange(str, i1 + nc, i - nc);
     }
   }
 
+  static QTextCharFormat codeFormat() {
+    QTextCharFormat fmt;
+
+    fmt.setForeground(QColor(0,128,0));
+    fmt.setFontFixedPitch(true);
+
+    return fmt;
+  }
+
  private:
-  CQMarkdownEditText *text_ { nullptr };
+  CQMarkdownEditText *text_         { nullptr };
+  StyleFlags          flags_;                  // style flags per UTF-8 byte (reused)
+  QTimer             *timer_        { nullptr }; // deferred highlight timer
+  bool                deferred_     { false };   // deferred highlight active
+  int                 frontier_     { -1 };      // last block of deferred highlight
+  int                 visibleStart_ { -1 };      // visible blocks (highlighted first)
+  int                 visibleEnd_   { -1 };
 };
 
 //------
@@ -221,14 +357,14 @@ CQMarkdownEdit(CQMarkdown *markdown) :
 
   timer_->setSingleShot(true);
 
-  connect(timer_, SIGNAL(timeout()), markdown_, SLOT(updatePreview()));
+  connect(timer_, SIGNAL(timeout()), this, SLOT(updateTimeoutSlot()));
 }
 
 void
 CQMarkdownEdit::
 setText(const QString &text)
 {
-  edit_->setText(text);
+  edit_->loadText(text);
 }
 
 QString
@@ -238,11 +374,51 @@ text() const
   return edit_->toPlainText();
 }
 
+void
+CQMarkdownEdit::
+gotoLine(int line)
+{
+  QTextBlock block = edit_->document()->findBlockByNumber(line);
+
+  if (! block.isValid())
+    return;
+
+  edit_->setTextCursor(QTextCursor(block));
+
+  edit_->ensureCursorVisible();
+
+  edit_->setFocus();
+}
+
 void
 CQMarkdownEdit::
 updateSlot()
 {
-  timer_->start(100);
+  // delay twice measured preview update time so updates use at most half the time
+  double updateTime = markdown_->preview()->updateTime();
+
+  updateDelay_ = std::min(std::max(int(2*updateTime), minUpdateDelay), maxUpdateDelay);
+
+  // coalesce with pending update (only one update pending)
+  if (! updatePending_) {
+    updatePending_ = true;
+
+    pendingTime_.start();
+  }
+  // don't delay pending update indefinitely while typing
+  else if (pendingTime_.elapsed() >= std::max(5*updateDelay_, minPendingTime))
+    return;
+
+  timer_->start(updateDelay_);
+}
+
+void
+CQMarkdownEdit::
+updateTimeoutSlot()
+{
+  updatePending_ = false;
+
+  markdown_->updatePreview();
 }
 
 void
@@ -720,6 +896,28 @@ CQMarkdownEditText(CQMarkdownEdit *edit) :
   highlighter_ = new CQMarkdownEditSyntaxHighlight(this);
 }
 
+void
+CQMarkdownEditText::
+loadText(const QString &text)
+{
+  // highlight large text in time slices
+  if (text.count('\n') > deferLines)
+    highlighter_->startDeferred(0);
+
+  setText(text);
+}
+
+void
+CQMarkdownEditText::
+insertFromMimeData(const QMimeData *source)
+{
+  // highlight large paste in time slices
+  if (source->hasText() && source->text().count('\n') > deferLines)
+    highlighter_->startDeferred(textCursor().blockNumber());
+
+  QTextEdit::insertFromMimeData(source);
+}
+
 void
 CQMarkdownEditText::
 keyPressEvent(QKeyEvent *e)
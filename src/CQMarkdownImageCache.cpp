@@ -0,0 +1,158 @@
+#include <CQMarkdownImageCache.h>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QImageReader>
+#include <QFileInfo>
+#include <cmath>
+#include <algorithm>
+
+CQMarkdownImageCache::
+CQMarkdownImageCache(QObject *parent) :
+ QObject(parent)
+{
+  setObjectName("imageCache");
+
+  // default budget 64MB
+  images_.setMaxCost(64*1024);
+}
+
+bool
+CQMarkdownImageCache::
+isImageUrl(const QUrl &url)
+{
+  return (url.isLocalFile() || url.scheme() == "");
+}
+
+QImage
+CQMarkdownImageCache::
+image(const QUrl &url)
+{
+  QString key = url.toString();
+
+  // decode in progress
+  if (pending_.contains(key))
+    return QImage();
+
+  // resolve file path once
+  auto pp = paths_.find(key);
+
+  if (pp == paths_.end()) {
+    QString fileName = (url.isLocalFile() ? url.toLocalFile() : url.path());
+
+    pp = paths_.insert(key, QFileInfo(fileName).absoluteFilePath());
+  }
+
+  const QString &path = pp.value();
+
+  //---
+
+  // use cached image (or failed decode) if file unchanged
+  ImageData *data = images_.object(key);
+
+  if (! data) {
+    auto pf = failed_.find(key);
+
+    if (pf != failed_.end())
+      data = &pf.value();
+  }
+
+  if (data) {
+    QFileInfo fi(path);
+
+    if (data->mtime == fi.lastModified() && data->size == fi.size())
+      return data->image;
+  }
+
+  startDecode(key, path);
+
+  return QImage();
+}
+
+void
+CQMarkdownImageCache::
+startDecode(const QString &key, const QString &path)
+{
+  QFileInfo fi(path);
+
+  QDateTime mtime = fi.lastModified();
+  qint64    size  = fi.size();
+
+  // largest decoded image (bytes) so one image cannot flush the cache
+  qint64 maxBytes = qint64(maxCost())*1024/2;
+
+  auto *watcher = new QFutureWatcher<QImage>(this);
+
+  pending_[key] = watcher;
+
+  connect(watcher, &QFutureWatcher<QImage>::finished, this,
+          [this, key, mtime, size, watcher]() {
+    pending_.remove(key);
+
+    QImage image = watcher->result();
+
+    // insert fails (and deletes data) if cost is over the budget
+    bool cached = false;
+
+    if (! image.isNull()) {
+      auto *data = new ImageData;
+
+      data->image = image;
+      data->mtime = mtime;
+      data->size  = size;
+
+      cached = images_.insert(key, data, imageCost(image));
+    }
+
+    // failed or uncacheable decode recorded (without image) so it is not
+    // retried until the file changes
+    if (cached)
+      failed_.remove(key);
+    else {
+      ImageData failed;
+
+      failed.mtime = mtime;
+      failed.size  = size;
+
+      failed_[key] = failed;
+    }
+
+    watcher->deleteLater();
+
+    emit imageLoaded(QUrl(key));
+  });
+
+  watcher->setFuture(QtConcurrent::run([path, maxBytes]() {
+    QImageReader reader(path);
+
+    reader.setAutoTransform(true);
+
+    // decode large image at reduced size to fit budget
+    QSize s = reader.size();
+
+    qint64 bytes = qint64(s.width())*s.height()*4;
+
+    if (s.isValid() && bytes > maxBytes) {
+      double f = std::sqrt(double(maxBytes)/bytes);
+
+      reader.setScaledSize(QSize(std::max(int(s.width()*f), 1), std::max(int(s.height()*f), 1)));
+    }
+
+    return reader.read();
+  }));
+}
+
+void
+CQMarkdownImageCache::
+clear()
+{
+  images_.clear();
+  paths_ .clear();
+  failed_.clear();
+}
+
+int
+CQMarkdownImageCache::
+imageCost(const QImage &image)
+{
+  return int((qint64(image.bytesPerLine())*image.height())/1024) + 1;
+}
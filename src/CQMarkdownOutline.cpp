@@ -0,0 +1,98 @@
+#include <CQMarkdownOutline.h>
+
+CQMarkdownOutline::
+CQMarkdownOutline(QWidget *parent) :
+ QTreeWidget(parent)
+{
+  setObjectName("outline");
+
+  setHeaderHidden(true);
+  setColumnCount(1);
+
+  connect(this, SIGNAL(itemClicked(QTreeWidgetItem *, int)),
+          this, SLOT(itemClickedSlot(QTreeWidgetItem *, int)));
+}
+
+void
+CQMarkdownOutline::
+setHeadings(const CMarkdown::Headings &headings)
+{
+  int nh = int(headings.size());
+
+  bool same = (nh == int(levels_.size()));
+
+  for (int i = 0; same && i < nh; ++i)
+    same = (headings[i].level == levels_[i]);
+
+  // same structure so update changed text and lines of existing items
+  if (same) {
+    for (int i = 0; i < nh; ++i) {
+      QTreeWidgetItem *item = items_[i];
+
+      QString text = QString::fromStdString(headings[i].text);
+
+      if (item->text(0) != text)
+        item->setText(0, text);
+
+      item->setData(0, Qt::UserRole, headings[i].line);
+    }
+
+    return;
+  }
+
+  //---
+
+  setUpdatesEnabled(false);
+
+  clear();
+
+  items_ .clear();
+  levels_.clear();
+
+  // parent of heading is last heading with lower level
+  struct Parent {
+    int              level { 0 };
+    QTreeWidgetItem *item  { nullptr };
+  };
+
+  std::vector<Parent> parents;
+
+  for (const auto &heading : headings) {
+    while (! parents.empty() && parents.back().level >= heading.level)
+      parents.pop_back();
+
+    QTreeWidgetItem *item;
+
+    if (parents.empty())
+      item = new QTreeWidgetItem(this);
+    else
+      item = new QTreeWidgetItem(parents.back().item);
+
+    item->setText(0, QString::fromStdString(heading.text));
+    item->setData(0, Qt::UserRole, heading.line);
+
+    Parent parent;
+
+    parent.level = heading.level;
+    parent.item  = item;
+
+    parents.push_back(parent);
+
+    items_ .push_back(item);
+    levels_.push_back(heading.level);
+  }
+
+  expandAll();
+
+  setUpdatesEnabled(true);
+}
+
+void
+CQMarkdownOutline::
+itemClickedSlot(QTreeWidgetItem *item, int)
+{
+  int line = item->data(0, Qt::UserRole).toInt();
+
+  if (line >= 0)
+    emit lineSelected(line);
+}
@@ -1,41 +1,164 @@
 #include <CQMarkdownPreview.h>
 #include <CQMarkdown.h>
-#include <CCommand.h>
+#include <CQMarkdownImageCache.h>
+#include <CQMarkdownRefRenderer.h>
 #ifdef USE_WEB_VIEW
 #include <QWebView>
 #endif
 #include <QTextEdit>
+#include <QTextDocument>
+#include <QTextDocumentFragment>
+#include <QTextCursor>
+#include <QTextBlock>
+#include <QTextFrame>
+#include <QAbstractTextDocumentLayout>
+#include <QScrollBar>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <algorithm>
 
 namespace {
 
-QString runMarkdown(const QString &str) {
-  char *env = getenv("CQMARKDOWN_EXEC");
+// documents with more lines than this only render blocks near the visible region
+const int largeDocLines = 20000;
 
-  CCommand cmd(env ? env : "markdown");
+// number of top level blocks rendered before and after the visible blocks
+const int renderMargin = 50;
 
-  cmd.addStringSrc(str.toStdString());
+// block format property set on first QTextBlock of each top level block
+const int blockStartProperty = QTextFormat::UserProperty + 1;
 
-  std::string res;
+// paragraph separating top level blocks inserted together (private use characters)
+const char *blockMarkerHtml = "<p>&#xe000;&#xe001;</p>";
 
-  cmd.addStringDest(res);
+const QString blockMarker = QString(QChar(0xe000)) + QChar(0xe001);
 
-  cmd.start();
+// mark first QTextBlock of each top level block of document with blocks separated by
+// n marker paragraphs and remove the markers (false if not n markers)
+bool markBlockStarts(QTextDocument *doc, int n) {
+  std::vector<QTextBlock> markers;
 
-  cmd.wait();
+  for (QTextBlock block = doc->begin(); block.isValid(); block = block.next()) {
+    if (block.text() == blockMarker)
+      markers.push_back(block);
+  }
+
+  if (int(markers.size()) != n)
+    return false;
+
+  QTextBlockFormat startFormat;
+
+  startFormat.setProperty(blockStartProperty, true);
+
+  QTextCursor cursor(doc);
+
+  cursor.mergeBlockFormat(startFormat);
+
+  auto blockFrame = [](const QTextBlock &block) { return QTextCursor(block).currentFrame(); };
+
+  // last first so positions of earlier markers are unchanged
+  for (auto p = markers.rbegin(); p != markers.rend(); ++p) {
+    QTextBlock marker = *p;
+    QTextBlock prev   = marker.previous();
+    QTextBlock next   = marker.next();
+
+    int pos = marker.position();
+    int len = blockMarker.length();
+
+    QTextFrame *frame = blockFrame(marker);
+
+    bool prevFrame = (! prev.isValid() || blockFrame(prev) != frame);
+    bool nextFrame = (! next.isValid() || blockFrame(next) != frame);
+
+    if      (! prevFrame) {
+      // remove separator before marker and marker (previous block keeps its format)
+      if (next.isValid())
+        QTextCursor(next).mergeBlockFormat(startFormat);
+
+      cursor.setPosition(pos - 1);
+      cursor.setPosition(pos + len, QTextCursor::KeepAnchor);
+
+      cursor.removeSelectedText();
+    }
+    else if (! nextFrame) {
+      // remove marker and separator after it (next block merged into marker block so
+      // its formats are restored)
+      QTextBlockFormat format     = next.blockFormat();
+      QTextCharFormat  charFormat = next.charFormat();
+
+      format.setProperty(blockStartProperty, true);
+
+      cursor.setPosition(pos);
+      cursor.setPosition(pos + len + 1, QTextCursor::KeepAnchor);
+
+      cursor.removeSelectedText();
+
+      cursor.setBlockFormat    (format);
+      cursor.setBlockCharFormat(charFormat);
+    }
+    else {
+      // block needed between frames so only marker text removed
+      if (next.isValid())
+        QTextCursor(next).mergeBlockFormat(startFormat);
+
+      cursor.setPosition(pos);
+      cursor.setPosition(pos + len, QTextCursor::KeepAnchor);
 
-  return QString(res.c_str());
+      cursor.removeSelectedText();
+    }
+  }
+
+  return true;
 }
 
 }
 
 //---
 
+// preview document which loads local images from the image cache instead of
+// reading them from disk each time the html is set
+class CQMarkdownPreviewDocument : public QTextDocument {
+ public:
+  CQMarkdownPreviewDocument(CQMarkdownImageCache *imageCache, QObject *parent) :
+   QTextDocument(parent), imageCache_(imageCache) {
+    // document is only edited by preview updates
+    setUndoRedoEnabled(false);
+  }
+
+ protected:
+  QVariant loadResource(int type, const QUrl &name) override {
+    if (type == QTextDocument::ImageResource && CQMarkdownImageCache::isImageUrl(name)) {
+      QImage image = imageCache_->image(name);
+
+      // not loaded yet (added when decode completes)
+      if (image.isNull())
+        return QVariant();
+
+      addResource(type, name, image);
+
+      return image;
+    }
+
+    return QTextDocument::loadResource(type, name);
+  }
+
+ private:
+  CQMarkdownImageCache *imageCache_ { nullptr };
+};
+
+//---
+
 CQMarkdownPreview::
 CQMarkdownPreview(CQMarkdown *markdown, bool ref) :
  QTabWidget(markdown), markdown_(markdown)
 {
   setObjectName("preview");
 
+  imageCache_ = new CQMarkdownImageCache(this);
+
+  connect(imageCache_, SIGNAL(imageLoaded(const QUrl &)),
+          this, SLOT(imageLoadedSlot(const QUrl &)));
+
 #ifdef USE_WEB_VIEW
   if (ref) {
     addTab(markHtmlEdit_ = new QWebView, "Mark-HTML");
@@ -51,12 +174,20 @@ CQMarkdownPreview(CQMarkdown *markdown, bool ref) :
 
     markHtmlEdit_->setReadOnly(true);
     refHtmlEdit_ ->setReadOnly(true);
+
+    refHtmlEdit_->setDocument(new CQMarkdownPreviewDocument(imageCache_, refHtmlEdit_));
   }
   else {
     addTab(markHtmlEdit_ = new QTextEdit, "HTML");
 
     markHtmlEdit_->setReadOnly(true);
   }
+
+  markHtmlEdit_->setDocument(new CQMarkdownPreviewDocument(imageCache_, markHtmlEdit_));
+
+  // render blocks of large document near visible region when scrolled
+  connect(markHtmlEdit_->verticalScrollBar(), SIGNAL(valueChanged(int)),
+          this, SLOT(scrollSlot()));
 #endif
 
   if (ref) {
@@ -78,8 +209,20 @@ CQMarkdownPreview(CQMarkdown *markdown, bool ref) :
   if (ref) {
     refHtmlEdit_->setObjectName("refHtmlEdit");
     refTextEdit_->setObjectName("refTextEdit");
+
+    // reference html rendered asynchronously (cached by content)
+    refRenderer_ = new CQMarkdownRefRenderer(this);
+
+    connect(refRenderer_, SIGNAL(rendered(const QString &, const QString &)),
+            this, SLOT(refRenderedSlot(const QString &, const QString &)));
   }
 
+  // highlight fenced code (not when comparing against reference output)
+  mark_.setHighlightCode(! ref);
+
+  // only visible tab is updated
+  connect(this, SIGNAL(currentChanged(int)), this, SLOT(currentChangedSlot(int)));
+
   setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 }
 
@@ -87,31 +230,676 @@ void
 CQMarkdownPreview::
 updateText()
 {
+  QElapsedTimer timer;
+
+  timer.start();
+
   QString str = markdown_->text();
 
+  // large documents only render blocks near the visible region (moved on scroll)
+#ifndef USE_WEB_VIEW
+  if (str.count('\n') > largeDocLines) {
+    if (renderEnd_ < 0) {
+      renderStart_ = 0;
+      renderEnd_   = 2*renderMargin;
+    }
+  }
+  else {
+    renderStart_ = 0;
+    renderEnd_   = -1;
+  }
+#endif
+
+  mark_.setRenderBlocks(renderStart_, renderEnd_);
+
+  fullHtml_.clear();
+
+  fullHtmlValid_ = false;
+
+  // html always needed (for text tab)
+  std::string html = mark_.textToHtml(str.toStdString());
+
+  // split into top level blocks for document patching (block ends are UTF-8 byte
+  // offsets so each block is converted separately to get its QString range)
+  html_.clear();
+
+  htmlBlocks_.clear();
+
+  int pos = 0;
+
+  for (const auto &end : mark_.blockEnds()) {
+    BlockRange range;
+
+    range.start = html_.length();
+
+    html_ += QString::fromUtf8(html.data() + pos, end - pos);
+
+    range.length = html_.length() - range.start;
+
+    htmlBlocks_.push_back(range);
+
+    pos = end;
+  }
+
+  if (pos < int(html.size()))
+    html_ += QString::fromUtf8(html.data() + pos, int(html.size()) - pos);
+
+  markHtmlDirty_ = true;
+  markTextDirty_ = true;
+
+  // reference command run when one of its tabs is shown
   if (refHtmlEdit_ || refTextEdit_) {
-    QString refHtml = runMarkdown(str);
+    refSrc_ = str;
+
+    refDirty_     = true;
+    refHtmlDirty_ = (refHtmlEdit_ != nullptr);
+    refTextDirty_ = (refTextEdit_ != nullptr);
+  }
+
+  updateCurrent();
 
-    if (refHtmlEdit_) {
+  updateTime_ = timer.nsecsElapsed()/1000000.0;
+
+  emit textUpdated(updateTime_);
+}
+
+void
+CQMarkdownPreview::
+updateCurrent()
+{
+  QWidget *w = currentWidget();
+
+  if      (w == markHtmlEdit_) {
+    if (markHtmlDirty_) {
 #ifdef USE_WEB_VIEW
-      refHtmlEdit_->setHtml(refHtml);
+      markHtmlEdit_->setHtml(html_);
 #else
-      refHtmlEdit_->setHtml(refHtml);
+      patchHtml();
 #endif
+
+      markHtmlDirty_ = false;
     }
+  }
+  else if (w == markTextEdit_) {
+    if (markTextDirty_) {
+      markTextEdit_->setPlainText(fullHtml());
 
-    if (refTextEdit_)
-      refTextEdit_->setPlainText(refHtml);
+      markTextDirty_ = false;
+    }
   }
+  else if (w && (w == refHtmlEdit_ || w == refTextEdit_)) {
+    // wait for reference command if result not cached
+    if (refDirty_) {
+      if (! refRenderer_->render(refSrc_, refHtml_))
+        return;
 
-  html_ = mark_.textToHtml(str);
+      refDirty_ = false;
+    }
 
+    if      (w == refHtmlEdit_ && refHtmlDirty_) {
 #ifdef USE_WEB_VIEW
-  markHtmlEdit_->setHtml(html_);
+      refHtmlEdit_->setHtml(refHtml_);
+#else
+      refHtmlEdit_->setHtml(refHtml_);
+#endif
+
+      refHtmlDirty_ = false;
+    }
+    else if (w == refTextEdit_ && refTextDirty_) {
+      refTextEdit_->setPlainText(refHtml_);
+
+      refTextDirty_ = false;
+    }
+  }
+}
+
+#ifndef USE_WEB_VIEW
+// update html document by replacing only the top level blocks which have changed
+// since the last update. Each block is inserted into its own QTextBlock(s) with a
+// block separator between blocks and adjacent changed blocks are inserted as one
+// fragment. The first QTextBlock of each block has the block start property so block
+// positions are found from the document after each edit. Unrendered blocks of large
+// documents are a single empty QTextBlock with the estimated height of the block so
+// the scroll range covers the whole document.
+void
+CQMarkdownPreview::
+patchHtml()
+{
+  QTextDocument *doc = markHtmlEdit_->document();
+
+  if (htmlBlocks_.empty() || docBlocks_.empty()) {
+    doc->clear();
+
+    docHtml_.clear();
+
+    docBlocks_      .clear();
+    docBlockStarts_ .clear();
+    docBlockHeights_.clear();
+  }
+
+  int no = docBlocks_ .size();
+  int nn = htmlBlocks_.size();
+
+  // find changed range (old i1->i2, new i1->j2) from common prefix and suffix
+  int i1 = 0;
+
+  while (i1 < no && i1 < nn && docBlock(i1) == htmlBlock(i1))
+    ++i1;
+
+  int ns = 0;
+
+  while (ns < no - i1 && ns < nn - i1 && docBlock(no - ns - 1) == htmlBlock(nn - ns - 1))
+    ++ns;
+
+  int i2 = no - ns;
+  int j2 = nn - ns;
+
+  if (i1 == i2 && i1 == j2) {
+    // source lines of unrendered blocks may have changed
+    updateBlockHeights();
+    return;
+  }
+
+  //---
+
+  // keep first visible block at same position if unchanged (else keep scroll position)
+  QScrollBar *vbar = markHtmlEdit_->verticalScrollBar();
+
+  int scroll = vbar->value();
+
+  int anchor = -1, anchorOffset = 0;
+  int first, last;
+
+  if (visibleBlocks(first, last) && (first < i1 || first >= i2)) {
+    anchor       = (first < i1 ? first : first + j2 - i2);
+    anchorOffset = docBlockTop(first) - scroll;
+  }
+
+  int oldCount = doc->characterCount();
+
+  QTextCursor cursor(doc);
+
+  cursor.beginEditBlock();
+
+  int start  = (no > 0 ? htmlBlockStart(i1) : 0);
+  int start1 = start; // start of new blocks
+
+  if (i2 > i1) {
+    // remove old blocks (and separator if no new blocks)
+    int end = htmlBlockStart(i2) - 1;
+
+    if (j2 == i1) {
+      if      (i2 < no) ++end;
+      else if (i1 > 0 ) --start;
+    }
+
+    cursor.setPosition(start);
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
+
+    cursor.removeSelectedText();
+  }
+  else {
+    // add separator for inserted blocks
+    if      (i1 < no) {
+      cursor.setPosition(start);
+      cursor.insertBlock();
+      cursor.setPosition(start);
+    }
+    else if (i1 > 0) {
+      cursor.setPosition(start - 1);
+      cursor.insertBlock();
+    }
+  }
+
+  // insert new blocks (runs of rendered blocks as one fragment)
+  for (int j = i1; j < j2; ) {
+    if (j > i1)
+      cursor.insertBlock();
+
+    if (htmlBlocks_[j].length > 0) {
+      int j1 = j;
+
+      while (j < j2 && htmlBlocks_[j].length > 0)
+        ++j;
+
+      insertHtmlBlocks(cursor, j1, j);
+    }
+    else {
+      // unrendered block left empty (height set when all blocks inserted)
+      QTextBlockFormat format;
+
+      format.setProperty(blockStartProperty, true);
+
+      cursor.setBlockFormat(format);
+
+      ++j;
+    }
+  }
+
+  cursor.endEditBlock();
+
+  //---
+
+  // start of new blocks from their first QTextBlock (after end of previous QTextBlock
+  // so a table frame is included), following blocks moved by change in length
+  int delta = doc->characterCount() - oldCount;
+
+  int end1 = (i2 < no ? docBlockStarts_[i2] + delta : doc->characterCount());
+
+  std::vector<int> starts;
+
+  QTextBlock block1 = (j2 > i1 ? doc->findBlock(start1) : QTextBlock());
+
+  for (QTextBlock block = block1; block.isValid(); block = block.next()) {
+    if (block.position() >= end1)
+      break;
+
+    if (! block.blockFormat().hasProperty(blockStartProperty))
+      continue;
+
+    QTextBlock prev = block.previous();
+
+    starts.push_back(prev.isValid() ? prev.position() + prev.length() : 0);
+  }
+
+  // block start lost by html import (e.g. merged into previous block) so rebuild
+  // whole document
+  if (int(starts.size()) != j2 - i1 && no > 0) {
+    docBlocks_.clear();
+
+    patchHtml();
+
+    return;
+  }
+
+  starts.resize(j2 - i1, end1);
+
+  for (int i = i2; i < no; ++i)
+    docBlockStarts_[i] += delta;
+
+  docBlockStarts_.erase (docBlockStarts_.begin() + i1, docBlockStarts_.begin() + i2);
+  docBlockStarts_.insert(docBlockStarts_.begin() + i1, starts.begin(), starts.end());
+
+  docHtml_   = html_;
+  docBlocks_ = htmlBlocks_;
+
+  // inserted blocks have html format, block after may have merged format of removed block
+  docBlockHeights_.erase (docBlockHeights_.begin() + i1, docBlockHeights_.begin() + i2);
+  docBlockHeights_.insert(docBlockHeights_.begin() + i1, j2 - i1, 0);
+
+  if (j2 < nn)
+    docBlockHeights_[j2] = -1;
+
+  updateBlockHeights();
+
+  if (anchor >= 0)
+    vbar->setValue(docBlockTop(anchor) - anchorOffset);
+  else
+    vbar->setValue(scroll);
+
+  // render blocks now in visible region
+  scrollSlot();
+}
+
+// set height of unrendered (empty) blocks to their estimated height
+void
+CQMarkdownPreview::
+updateBlockHeights()
+{
+  QTextDocument *doc = markHtmlEdit_->document();
+
+  int lineSpacing = QFontMetrics(doc->defaultFont()).lineSpacing();
+
+  QTextCursor cursor(doc);
+
+  cursor.beginEditBlock();
+
+  int nb = int(docBlockStarts_.size());
+
+  for (int i = 0; i < nb; ++i) {
+    int height = (docBlocks_[i].length == 0 ? estimateBlockHeight(i, lineSpacing) : 0);
+
+    if (height != docBlockHeights_[i]) {
+      int pos = docBlockStarts_[i];
+
+      QTextBlockFormat format = doc->findBlock(pos).blockFormat();
+
+      if (height > 0)
+        format.setLineHeight(height, QTextBlockFormat::FixedHeight);
+      else {
+        format.clearProperty(QTextFormat::LineHeight);
+        format.clearProperty(QTextFormat::LineHeightType);
+      }
+
+      cursor.setPosition(pos);
+      cursor.setBlockFormat(format);
+
+      docBlockHeights_[i] = height;
+    }
+  }
+
+  cursor.endEditBlock();
+}
+
+// estimate height of block from number of source lines (plus paragraph spacing)
+int
+CQMarkdownPreview::
+estimateBlockHeight(int i, int lineSpacing) const
+{
+  const CMarkdown::BlockPos &blockPos = mark_.blockSourcePos();
+
+  int nl = 1;
+
+  if (i < int(blockPos.size()) && blockPos[i].isValid())
+    nl = blockPos[i].endLine - blockPos[i].startLine + 1;
+
+  return (nl + 1)*lineSpacing;
+}
+
+// get y position of top level block in html document
+int
+CQMarkdownPreview::
+docBlockTop(int i) const
+{
+  QTextDocument *doc = markHtmlEdit_->document();
+
+  QTextBlock block = doc->findBlock(htmlBlockStart(i));
+
+  return int(doc->documentLayout()->blockBoundingRect(block).top());
+}
+
+// get index of top level block containing html document position
+int
+CQMarkdownPreview::
+docPosBlock(int pos) const
+{
+  auto p = std::upper_bound(docBlockStarts_.begin(), docBlockStarts_.end(), pos);
+
+  return std::max(int(p - docBlockStarts_.begin()) - 1, 0);
+}
+
+// get range of top level blocks in visible region of html document (false if none)
+bool
+CQMarkdownPreview::
+visibleBlocks(int &first, int &last) const
+{
+  if (docBlockStarts_.empty())
+    return false;
+
+  QWidget *viewport = markHtmlEdit_->viewport();
+
+  QPoint p1(0, 0);
+  QPoint p2(viewport->width() - 1, viewport->height() - 1);
+
+  first = docPosBlock(markHtmlEdit_->cursorForPosition(p1).position());
+  last  = docPosBlock(markHtmlEdit_->cursorForPosition(p2).position());
+
+  return true;
+}
+
+// get document position of top level block (end of document after last block)
+int
+CQMarkdownPreview::
+htmlBlockStart(int i) const
+{
+  if (i < int(docBlockStarts_.size()))
+    return docBlockStarts_[i];
+
+  return markHtmlEdit_->document()->characterCount();
+}
+
+QStringRef
+CQMarkdownPreview::
+htmlBlock(int i) const
+{
+  return html_.midRef(htmlBlocks_[i].start, htmlBlocks_[i].length);
+}
+
+QStringRef
+CQMarkdownPreview::
+docBlock(int i) const
+{
+  return docHtml_.midRef(docBlocks_[i].start, docBlocks_[i].length);
+}
+
+// insert html of blocks j1 to j2 (exclusive) at cursor in empty block as one fragment,
+// keeping format of first html block. The html is parsed by a preview document with
+// the same settings as the target so images load from the image cache and relative
+// urls resolve as for a full setHtml. Blocks are separated by marker paragraphs which
+// are removed when the start of each block is marked.
+void
+CQMarkdownPreview::
+insertHtmlBlocks(QTextCursor &cursor, int j1, int j2)
+{
+  QTextDocument *target = cursor.document();
+
+  CQMarkdownPreviewDocument doc(imageCache_, nullptr);
+
+  doc.setBaseUrl          (target->baseUrl());
+  doc.setDefaultFont      (target->defaultFont());
+  doc.setDefaultStyleSheet(target->defaultStyleSheet());
+
+  QString html;
+
+  for (int j = j1; j < j2; ++j) {
+    if (j > j1)
+      html += blockMarkerHtml;
+
+    html += htmlBlock(j);
+  }
+
+  doc.setHtml(html);
+
+  // marker text in block html so blocks inserted separately
+  if (! markBlockStarts(&doc, j2 - j1 - 1) && j2 - j1 > 1) {
+    for (int j = j1; j < j2; ++j) {
+      if (j > j1)
+        cursor.insertBlock();
+
+      insertHtmlBlocks(cursor, j, j + 1);
+    }
+
+    return;
+  }
+
+  QTextBlock block = doc.begin();
+
+  QTextBlockFormat format = block.blockFormat();
+
+  format.setProperty(blockStartProperty, true);
+
+  cursor.setBlockFormat    (format);
+  cursor.setBlockCharFormat(block.charFormat());
+
+  cursor.insertFragment(QTextDocumentFragment(&doc));
+}
+#endif
+
+QString
+CQMarkdownPreview::
+fullHtml() const
+{
+  if (! mark_.isTruncated())
+    return html_;
+
+  // converted when first needed after update
+  if (! fullHtmlValid_) {
+    CMarkdown mark;
+
+    mark.setHighlightCode(mark_.isHighlightCode());
+
+    fullHtml_ = QString::fromStdString(mark.textToHtml(markdown_->text().toStdString()));
+
+    fullHtmlValid_ = true;
+  }
+
+  return fullHtml_;
+}
+
+void
+CQMarkdownPreview::
+scrollSlot()
+{
+#ifndef USE_WEB_VIEW
+  if (renderEnd_ < 0 || renderPending_)
+    return;
+
+  // render again when visible region nears either end of rendered blocks
+  int first, last;
+
+  if (! visibleBlocks(first, last))
+    return;
+
+  int nb = int(docBlocks_.size());
+
+  if ((renderStart_ == 0  || first >= renderStart_ + renderMargin/2) &&
+      (renderEnd_   >= nb || last  <  renderEnd_   - renderMargin/2))
+    return;
+
+  // defer update until scroll handled
+  renderPending_ = true;
+
+  QTimer::singleShot(0, this, SLOT(renderSlot()));
+#endif
+}
+
+void
+CQMarkdownPreview::
+renderSlot()
+{
+#ifndef USE_WEB_VIEW
+  renderPending_ = false;
+
+  int first, last;
+
+  if (renderEnd_ < 0 || ! visibleBlocks(first, last))
+    return;
+
+  // render visible blocks and margin either side
+  renderStart_ = std::max(first - renderMargin, 0);
+  renderEnd_   = last + renderMargin + 1;
+
+  renderBlocks(renderStart_, renderEnd_);
+#endif
+}
+
+#ifndef USE_WEB_VIEW
+// render blocks in range not yet rendered from the block skeleton of the last update
+// (text not converted again) and patch them into the html document
+void
+CQMarkdownPreview::
+renderBlocks(int start, int end)
+{
+  int nb = int(htmlBlocks_.size());
+
+  end = std::min(end, nb);
+
+  // html of unrendered blocks in range (null for others)
+  std::vector<QString> rendered(std::max(end - start, 0));
+
+  bool changed = false;
+
+  for (int i = start; i < end; ) {
+    if (htmlBlocks_[i].length > 0) {
+      ++i;
+      continue;
+    }
+
+    int i1 = i;
+
+    while (i < end && htmlBlocks_[i].length == 0)
+      ++i;
+
+    CMarkdown::Strings strs = mark_.renderBlocks(i1, i);
+
+    for (int k = 0; k < int(strs.size()); ++k) {
+      rendered[i1 + k - start] = QString::fromStdString(strs[k]);
+
+      changed = true;
+    }
+  }
+
+  if (! changed)
+    return;
+
+  // rebuild html with rendered blocks (other blocks copied)
+  QString     html;
+  BlockRanges blocks;
+
+  blocks.reserve(nb);
+
+  for (int i = 0; i < nb; ++i) {
+    BlockRange range;
+
+    range.start = html.length();
+
+    if (i >= start && i < end && htmlBlocks_[i].length == 0)
+      html += rendered[i - start];
+    else
+      html += htmlBlock(i);
+
+    range.length = html.length() - range.start;
+
+    blocks.push_back(range);
+  }
+
+  // text after last block
+  if (nb > 0)
+    html += html_.midRef(htmlBlocks_.back().start + htmlBlocks_.back().length);
+
+  html_       = html;
+  htmlBlocks_ = blocks;
+
+  markHtmlDirty_ = true;
+
+  updateCurrent();
+}
+#endif
+
+void
+CQMarkdownPreview::
+currentChangedSlot(int)
+{
+  updateCurrent();
+}
+
+void
+CQMarkdownPreview::
+refRenderedSlot(const QString &text, const QString &html)
+{
+  // ignore result for old text
+  if (! refDirty_ || text != refSrc_)
+    return;
+
+  refHtml_  = html;
+  refDirty_ = false;
+
+  updateCurrent();
+}
+
+void
+CQMarkdownPreview::
+imageLoadedSlot(const QUrl &url)
+{
+#ifndef USE_WEB_VIEW
+  QImage image = imageCache_->image(url);
+
+  if (image.isNull())
+    return;
+
+  // add decoded image to documents and relayout
+  for (auto *edit : {markHtmlEdit_, refHtmlEdit_}) {
+    if (! edit) continue;
+
+    QTextDocument *doc = edit->document();
+
+    doc->addResource(QTextDocument::ImageResource, url, image);
+
+    doc->markContentsDirty(0, doc->characterCount());
+  }
 #else
-  markHtmlEdit_->setHtml(html_);
+  Q_UNUSED(url);
 #endif
-  markTextEdit_->setPlainText(html_);
 }
 
 QSize
@@ -0,0 +1,152 @@
+#include <CQMarkdownRefRenderer.h>
+#include <CMarkdownString.h>
+#include <QProcess>
+
+CQMarkdownRefRenderer::
+CQMarkdownRefRenderer(QObject *parent) :
+ QObject(parent)
+{
+  setObjectName("refRenderer");
+
+  char *env = getenv("CQMARKDOWN_EXEC");
+
+  QString cmd = (env ? env : "markdown");
+
+  command_ = cmd.split(" ", Qt::SkipEmptyParts);
+
+  // default budget 16MB
+  cache_.setMaxCost(16*1024);
+}
+
+bool
+CQMarkdownRefRenderer::
+render(const QString &text, QString &html)
+{
+  lastText_ = text;
+
+  Entry *entry = cache_.object(textKey(text));
+
+  if (entry && entry->text == text) {
+    html = entry->html;
+    return true;
+  }
+
+  // command running so only keep latest text
+  if (process_) {
+    hasPending_ = (text != runText_);
+
+    if (hasPending_)
+      pending_ = text;
+    else
+      pending_.clear();
+
+    return false;
+  }
+
+  startProcess(text);
+
+  return false;
+}
+
+void
+CQMarkdownRefRenderer::
+clear()
+{
+  cache_.clear();
+}
+
+void
+CQMarkdownRefRenderer::
+startProcess(const QString &text)
+{
+  if (command_.empty())
+    return;
+
+  runKey_  = textKey(text);
+  runText_ = text;
+
+  QProcess *process = new QProcess(this);
+
+  process_ = process;
+
+  // process done when finished or failed to start (other errors are followed by
+  // finished). Only the first signal of the current process is handled
+  connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+          this, [this, process]() { processFinished(process); });
+  connect(process, &QProcess::errorOccurred,
+          this, [this, process](QProcess::ProcessError error) {
+    if (error == QProcess::FailedToStart)
+      processFinished(process);
+  });
+
+  process->start(command_[0], command_.mid(1));
+
+  // failed to start (already handled)
+  if (process != process_)
+    return;
+
+  process->write(text.toUtf8());
+
+  process->closeWriteChannel();
+}
+
+void
+CQMarkdownRefRenderer::
+processFinished(QProcess *process)
+{
+  // ignore process no longer running command (already handled)
+  if (process != process_)
+    return;
+
+  process_ = nullptr;
+
+  // no more signals from this process
+  disconnect(process, nullptr, this, nullptr);
+
+  bool ok = (process->error() == QProcess::UnknownError &&
+             process->exitStatus() == QProcess::NormalExit);
+
+  QString html = QString::fromUtf8(process->readAllStandardOutput());
+
+  process->deleteLater();
+
+  // only cache successful results (cost includes source text)
+  if (ok) {
+    Entry *entry = new Entry;
+
+    entry->text = runText_;
+    entry->html = html;
+
+    cache_.insert(runKey_, entry, (runText_.length() + html.length())/1024 + 1);
+  }
+
+  if (runText_ == lastText_)
+    emit rendered(runText_, html);
+
+  runText_.clear();
+
+  //---
+
+  // render latest text requested while running
+  if (hasPending_) {
+    QString text = pending_;
+
+    hasPending_ = false;
+
+    pending_.clear();
+
+    QString html1;
+
+    if (render(text, html1))
+      emit rendered(text, html1);
+  }
+}
+
+quint64
+CQMarkdownRefRenderer::
+textKey(const QString &text)
+{
+  QByteArray utf8 = text.toUtf8();
+
+  return CMarkdownString::hashString(std::string_view(utf8.constData(), size_t(utf8.size())));
+}
@@ -0,0 +1,25 @@
+TEMPLATE = app
+
+TARGET = CQMarkdownBench
+
+DEPENDPATH += .
+
+CONFIG -= qt
+
+CONFIG += console
+
+QMAKE_CXXFLAGS += -std=c++17
+
+SOURCES += \
+bench.cpp \
+
+DESTDIR     = ../bin
+OBJECTS_DIR = ../obj
+
+INCLUDEPATH += \
+. \
+../include \
+
+unix:LIBS += \
+-L../lib \
+-lCMarkdown
@@ -0,0 +1,28 @@
+TEMPLATE = app
+
+TARGET = CQMarkdownCli
+
+DEPENDPATH += .
+
+# conversion only (no Qt libraries)
+CONFIG -= qt
+
+CONFIG += console
+
+DEFINES += CQMARKDOWN_CLI
+
+QMAKE_CXXFLAGS += -std=c++17
+
+SOURCES += \
+main.cpp \
+
+DESTDIR     = ../bin
+OBJECTS_DIR = ../obj/cli
+
+INCLUDEPATH += \
+. \
+../include \
+
+unix:LIBS += \
+-L../lib \
+-lCMarkdown
@@ -23,7 +23,7 @@ CQMarkdownConfigDlg(CQMarkdownMain *main) :
   auto addTagEdit = [&](QGridLayout *styleLayout, CMarkdownTagType type, int &row) {
     TagEdit &tagEdit = tagEdits_[type];
 
-    QString name = CMarkdown::typeName(type);
+    QString name = QString::fromStdString(CMarkdown::typeName(type));
 
     tagEdit.colorEdit = new QLineEdit;
     tagEdit.fontEdit  = new QLineEdit;
@@ -32,8 +32,8 @@ CQMarkdownConfigDlg(CQMarkdownMain *main) :
     styleLayout->addWidget(tagEdit.colorEdit, row, 1);
     styleLayout->addWidget(tagEdit.fontEdit , row, 2);
 
-    tagEdit.colorEdit->setText(CMarkdown::typeColor(type));
-    tagEdit.fontEdit ->setText(CMarkdown::typeFont (type));
+    tagEdit.colorEdit->setText(QString::fromStdString(CMarkdown::typeColor(type)));
+    tagEdit.fontEdit ->setText(QString::fromStdString(CMarkdown::typeFont (type)));
 
     ++row;
   };
@@ -79,8 +79,8 @@ CQMarkdownConfigDlg::
 applySlot()
 {
   for (const auto &p : tagEdits_) {
-    QString color = p.second.colorEdit->text();
-    QString font  = p.second.fontEdit ->text();
+    std::string color = p.second.colorEdit->text().toStdString();
+    std::string font  = p.second.fontEdit ->text().toStdString();
 
     CMarkdown::setTypeColor(p.first, color);
     CMarkdown::setTypeFont (p.first, font );
@@ -2,7 +2,12 @@
 #include <CQMarkdownConfigDlg.h>
 #include <CQMarkdown.h>
 #include <CQMarkdownEdit.h>
+#include <CQMarkdownPreview.h>
+#include <CQMarkdownOutline.h>
+#include <QDockWidget>
 #include <QMenuBar>
+#include <QStatusBar>
+#include <QLabel>
 #include <QMenu>
 #include <QAction>
 #include <QFileDialog>
@@ -82,6 +87,32 @@ CQMarkdownMain(bool ref) :
   connect(configAction, SIGNAL(triggered()), this, SLOT(configSlot()));
 
   viewMenu->addAction(configAction);
+
+  //----
+
+  // outline of headings (from preview conversion), click moves editor to heading
+  outline_ = new CQMarkdownOutline;
+
+  QDockWidget *outlineDock = new QDockWidget("Outline", this);
+
+  outlineDock->setObjectName("outlineDock");
+  outlineDock->setWidget(outline_);
+
+  addDockWidget(Qt::LeftDockWidgetArea, outlineDock);
+
+  viewMenu->addAction(outlineDock->toggleViewAction());
+
+  connect(outline_, SIGNAL(lineSelected(int)), markdown_->edit(), SLOT(gotoLine(int)));
+
+  //----
+
+  // preview update latency
+  timeLabel_ = new QLabel;
+
+  statusBar()->addPermanentWidget(timeLabel_);
+
+  connect(markdown_->preview(), SIGNAL(textUpdated(double)),
+          this, SLOT(previewUpdatedSlot(double)));
 }
 
 void
@@ -170,6 +201,16 @@ configSlot()
   configDlg_->show();
 }
 
+void
+CQMarkdownMain::
+previewUpdatedSlot(double ms)
+{
+  timeLabel_->setText(QString("Preview: %1 ms (delay %2 ms)").
+    arg(ms, 0, 'f', 1).arg(markdown_->edit()->updateDelay()));
+
+  outline_->setHeadings(markdown_->preview()->headings());
+}
+
 void
 CQMarkdownMain::
 updateText()
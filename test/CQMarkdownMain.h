@@ -5,6 +5,8 @@
 
 class CQMarkdown;
 class CQMarkdownConfigDlg;
+class CQMarkdownOutline;
+class QLabel;
 
 class CQMarkdownMain : public QMainWindow {
   Q_OBJECT
@@ -28,9 +30,13 @@ class CQMarkdownMain : public QMainWindow {
 
   void configSlot();
 
+  void previewUpdatedSlot(double ms);
+
  private:
   CQMarkdown*          markdown_  { nullptr };
   CQMarkdownConfigDlg* configDlg_ { nullptr };
+  CQMarkdownOutline*   outline_   { nullptr };
+  QLabel*              timeLabel_ { nullptr };
 };
 
 #endif
@@ -4,9 +4,9 @@ TARGET = CQMarkdownMain
 
 DEPENDPATH += .
 
-QT += widgets
+QT += widgets concurrent
 
-QMAKE_CXXFLAGS += -std=c++14
+QMAKE_CXXFLAGS += -std=c++17
 
 SOURCES += \
 main.cpp \
@@ -24,16 +24,14 @@ INCLUDEPATH += \
 . \
 ../include \
 ../../CQUtil/include \
-../../CCommand/include \
 ../../CUtil/include \
 
 unix:LIBS += \
 -L../lib \
 -L../../CQUtil/lib \
--L../../CCommand/lib \
 -L../../CReadLine/lib \
 -L../../CStrUtil/lib \
 -L../../CFile/lib \
 -L../../COS/lib \
--lCQMarkdown -lCQUtil -lCCommand -lCReadLine -lCFile -lCStrUtil -lCOS \
+-lCQMarkdown -lCMarkdown -lCQUtil -lCReadLine -lCFile -lCStrUtil -lCOS \
 -lreadline -lcurses
@@ -0,0 +1,541 @@
+// Converter throughput benchmark.
+//
+// Runs CMarkdown::textToHtml/textToTty over each file of the test corpus and over
+// the whole corpus concatenated N times and writes results as JSON to stdout:
+//   mb_per_s      : input MB (UTF-8) converted per second
+//   ns_per_line   : time per input line
+//   allocs_per_kb : heap allocations per KB of input (one conversion)
+//   peak_rss_kb   : peak resident set size of the case
+//
+// Each case runs in a forked child process (input built in the child) so the peak
+// RSS is that of the case only. It still includes the baseline of the process
+// (libraries and loaded corpus) so only differences between cases are meaningful.
+//
+// The HTML escape kernel (CMarkdownEmitter::findEscape) is also timed on its own,
+// SIMD and scalar, over a generated code heavy document scanned as the emitter
+// does (each escape character ends a run):
+//   mb_per_s      : input MB scanned per second
+//
+// Allocations are counted by interposing the glibc allocation functions (malloc,
+// calloc, realloc, memalign, posix_memalign, aligned_alloc, valloc, pvalloc) so
+// they cover all heap allocations made by the conversion. Frees are not counted.
+// On other C libraries only operator new is counted.
+//
+// Usage: CQMarkdownBench [-data <dir>] [-scale <n,...>] [-time <ms>] [-html|-text]
+//                        [-no-kernel]
+
+#include <CMarkdown.h>
+#include <CMarkdownEmitter.h>
+#include <CMarkdownString.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <functional>
+#include <cerrno>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<size_t> numAllocs { 0 };
+
+}
+
+//---
+
+// count heap allocations (intercept malloc directly on glibc so C allocations are included)
+#ifdef __GLIBC__
+extern "C" {
+
+void *__libc_malloc  (size_t size);
+void *__libc_calloc  (size_t n, size_t size);
+void *__libc_realloc (void *p, size_t size);
+void *__libc_memalign(size_t align, size_t size);
+void *__libc_valloc  (size_t size);
+void *__libc_pvalloc (size_t size);
+
+void *malloc(size_t size) {
+  ++numAllocs;
+
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+  ++numAllocs;
+
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size) {
+  ++numAllocs;
+
+  return __libc_realloc(p, size);
+}
+
+void *memalign(size_t align, size_t size) {
+  ++numAllocs;
+
+  return __libc_memalign(align, size);
+}
+
+void *aligned_alloc(size_t align, size_t size) {
+  ++numAllocs;
+
+  return __libc_memalign(align, size);
+}
+
+int posix_memalign(void **p, size_t align, size_t size) {
+  // alignment must be power of two multiple of pointer size
+  if (align % sizeof(void *) != 0 || (align & (align - 1)) != 0)
+    return EINVAL;
+
+  ++numAllocs;
+
+  void *p1 = __libc_memalign(align, size);
+
+  if (! p1)
+    return ENOMEM;
+
+  *p = p1;
+
+  return 0;
+}
+
+void *valloc(size_t size) {
+  ++numAllocs;
+
+  return __libc_valloc(size);
+}
+
+void *pvalloc(size_t size) {
+  ++numAllocs;
+
+  return __libc_pvalloc(size);
+}
+
+}
+#else
+void *operator new(size_t size) {
+  ++numAllocs;
+
+  void *p = std::malloc(size ? size : 1);
+
+  if (! p)
+    throw std::bad_alloc();
+
+  return p;
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+#endif
+
+//---
+
+namespace {
+
+// measured values (plain data so they can be returned from child process)
+struct Measure {
+  int64_t bytes       { 0 };
+  int64_t lines       { 0 };
+  int     iterations  { 0 };
+  double  mbPerSec    { 0.0 };
+  double  nsPerLine   { 0.0 };
+  double  allocsPerKb { 0.0 };
+  long    peakRss     { 0 };
+};
+
+struct Result {
+  std::string name;
+  int         scale { 0 };
+  Measure     measure;
+};
+
+std::string readFile(const std::string &filename) {
+  std::ifstream is(filename, std::ios::binary);
+
+  std::stringstream ss;
+
+  ss << is.rdbuf();
+
+  return ss.str();
+}
+
+long peakRss() {
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+
+  return usage.ru_maxrss; // KB on linux
+}
+
+// convert text repeatedly until minimum time has elapsed
+Measure runBench(const std::string &text, bool tty, int minTime) {
+  using Clock = std::chrono::steady_clock;
+
+  Measure result;
+
+  result.bytes = int64_t(text.size());
+  result.lines = std::count(text.begin(), text.end(), '\n') + 1;
+
+  auto convert = [&]() {
+    CMarkdown markdown;
+
+    std::string str = (tty ? markdown.textToTty(text) : markdown.textToHtml(text));
+
+    return str.size();
+  };
+
+  // count allocations of single (warm) conversion
+  (void) convert();
+
+  size_t allocs1 = numAllocs;
+
+  (void) convert();
+
+  size_t allocs2 = numAllocs;
+
+  //---
+
+  Clock::time_point start = Clock::now();
+
+  int64_t elapsed = 0;
+
+  do {
+    (void) convert();
+
+    ++result.iterations;
+
+    elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  } while (elapsed < int64_t(minTime)*1000000);
+
+  double secs = elapsed/1e9/result.iterations;
+
+  result.mbPerSec    = (result.bytes/1e6)/secs;
+  result.nsPerLine   = secs*1e9/result.lines;
+  result.allocsPerKb = double(allocs2 - allocs1)/std::max(result.bytes/1024.0, 1.0);
+  result.peakRss     = peakRss();
+
+  return result;
+}
+
+// run benchmark of text (built by function) in child process so peak RSS is for
+// this case only (run in this process if fork fails)
+Result runCase(const std::string &name, const std::function<std::string()> &textFn,
+               bool tty, int minTime) {
+  Result result;
+
+  result.name = name;
+
+  int fds[2];
+
+  pid_t pid = (pipe(fds) == 0 ? fork() : -1);
+
+  if (pid < 0) {
+    std::cerr << "Failed to fork, peak RSS is for whole process\n";
+
+    result.measure = runBench(textFn(), tty, minTime);
+
+    return result;
+  }
+
+  if (pid == 0) {
+    close(fds[0]);
+
+    Measure measure = runBench(textFn(), tty, minTime);
+
+    bool ok = (write(fds[1], &measure, sizeof(measure)) == ssize_t(sizeof(measure)));
+
+    _exit(ok ? 0 : 1);
+  }
+
+  close(fds[1]);
+
+  Measure measure;
+
+  if (read(fds[0], &measure, sizeof(measure)) == ssize_t(sizeof(measure)))
+    result.measure = measure;
+  else
+    std::cerr << "No result for '" << name << "'\n";
+
+  close(fds[0]);
+
+  waitpid(pid, nullptr, 0);
+
+  return result;
+}
+
+// generated code heavy document (fenced C++ blocks between short paragraphs) of
+// given number of lines
+std::string codeDocument(int numLines) {
+  static const char *code[] = {
+    "template<typename T> bool less(const T &a, const T &b) { return a < b; }",
+    "  if (p != nullptr && p->size() > 0 && s == \"<none>\")",
+    "    std::cerr << \"value: \" << map[\"key\"] << \" & \" << x << '\\n';",
+    "  for (int i = 0; i < n; ++i) v.push_back(std::make_pair(i, i*i));",
+    "  std::vector<std::pair<std::string,int>> items; // name -> count",
+    "  return (a && b) ? std::min<int>(x, y) : std::max<int>(x, y);",
+  };
+
+  const int nc = int(sizeof(code)/sizeof(code[0]));
+
+  std::string str;
+
+  for (int i = 0, j = 0; i < numLines; ++i) {
+    if      (i % 20 == 0)
+      str += "Text with <b>inline</b> markup & \"quoted\" words for the paragraph.\n";
+    else if (i % 20 == 1 || i % 20 == 19)
+      str += (i % 20 == 1 ? "```cpp\n" : "```\n\n");
+    else
+      str += std::string(code[j++ % nc]) + "\n";
+  }
+
+  return str;
+}
+
+// time escape kernel scanning text as emitter does (restart after each escape
+// character) until minimum time has elapsed
+Measure runKernel(const std::string &text, bool simd, int minTime) {
+  using Clock = std::chrono::steady_clock;
+
+  Measure result;
+
+  result.bytes = int64_t(text.size());
+  result.lines = std::count(text.begin(), text.end(), '\n') + 1;
+
+  const char *data = text.data();
+  int         len  = int(text.size());
+
+  int64_t found = 0;
+
+  auto scan = [&]() {
+    for (int i = 0; i < len; ) {
+      int i1 = i + (simd ?
+        CMarkdownEmitter::findEscape      (data + i, len - i, CMarkdownEmitter::Escape::TEXT) :
+        CMarkdownEmitter::findEscapeScalar(data + i, len - i, CMarkdownEmitter::Escape::TEXT));
+
+      found += i1;
+
+      i = i1 + 1;
+    }
+  };
+
+  scan(); // warm
+
+  Clock::time_point start = Clock::now();
+
+  int64_t elapsed = 0;
+
+  do {
+    scan();
+
+    ++result.iterations;
+
+    elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  } while (elapsed < int64_t(minTime)*1000000);
+
+  double secs = elapsed/1e9/result.iterations;
+
+  result.mbPerSec  = (result.bytes/1e6)/secs;
+  result.nsPerLine = secs*1e9/result.lines;
+
+  // keep scan result used
+  if (found < 0)
+    std::cerr << found << "\n";
+
+  return result;
+}
+
+std::string jsonString(const std::string &str) {
+  std::string str1 = "\"";
+
+  for (const auto &c : str) {
+    if      (c == '"' || c == '\\') { str1 += '\\'; str1 += c; }
+    else if (c >= 0 && c < ' ')     { str1 += ' '; }
+    else                            { str1 += c; }
+  }
+
+  return str1 + "\"";
+}
+
+void printKernel(const std::string &name, const Measure &measure, bool last) {
+  printf("    {\"name\": %s, \"bytes\": %lld, \"lines\": %lld, \"iterations\": %d, "
+         "\"mb_per_s\": %.3f, \"ns_per_line\": %.1f}%s\n",
+         jsonString(name).c_str(), (long long) measure.bytes, (long long) measure.lines,
+         measure.iterations, measure.mbPerSec, measure.nsPerLine, (last ? "" : ","));
+}
+
+void printResult(const Result &result, bool last) {
+  const Measure &measure = result.measure;
+
+  printf("    {\"name\": %s, \"scale\": %d, \"bytes\": %lld, \"lines\": %lld, "
+         "\"iterations\": %d, \"mb_per_s\": %.3f, \"ns_per_line\": %.1f, "
+         "\"allocs_per_kb\": %.2f, \"peak_rss_kb\": %ld}%s\n",
+         jsonString(result.name).c_str(), result.scale,
+         (long long) measure.bytes, (long long) measure.lines, measure.iterations,
+         measure.mbPerSec, measure.nsPerLine, measure.allocsPerKb, measure.peakRss,
+         (last ? "" : ","));
+}
+
+}
+
+int
+main(int argc, char **argv)
+{
+  std::string dataDir  = "../data";
+  std::string scaleStr = "1,10,100,1000,10000";
+  int         minTime  = 200;
+  bool        html     = true;
+  bool        text     = true;
+  bool        kernel   = true;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+
+    if      (arg == "-data" && i < argc - 1)
+      dataDir = argv[++i];
+    else if (arg == "-scale" && i < argc - 1)
+      scaleStr = argv[++i];
+    else if (arg == "-time" && i < argc - 1)
+      minTime = atoi(argv[++i]);
+    else if (arg == "-html")
+      text = false;
+    else if (arg == "-text")
+      html = false;
+    else if (arg == "-no-kernel")
+      kernel = false;
+    else {
+      std::cerr << "Usage: CQMarkdownBench [-data <dir>] [-scale <n,...>] "
+                   "[-time <ms>] [-html|-text] [-no-kernel]\n";
+      return 1;
+    }
+  }
+
+  //---
+
+  // load corpus (*.txt and *.md files in name order)
+  std::vector<std::string> files;
+
+  std::error_code ec;
+
+  for (const auto &entry : std::filesystem::directory_iterator(dataDir, ec)) {
+    std::string ext = entry.path().extension().string();
+
+    if (entry.is_regular_file() && (ext == ".txt" || ext == ".md"))
+      files.push_back(entry.path().filename().string());
+  }
+
+  std::sort(files.begin(), files.end());
+
+  if (files.empty()) {
+    std::cerr << "No corpus files in '" << dataDir << "'\n";
+    return 1;
+  }
+
+  std::vector<std::pair<std::string,std::string>> corpus;
+
+  std::string all;
+
+  for (const auto &file : files) {
+    std::string str = readFile((std::filesystem::path(dataDir) / file).string());
+
+    corpus.push_back(std::make_pair(file, str));
+
+    all += str;
+
+    if (! CMarkdownString::endsWith(all, "\n"))
+      all += '\n';
+  }
+
+  std::vector<int> scales;
+
+  for (const auto &s : CMarkdownString::split(scaleStr, ','))
+    scales.push_back(std::max(atoi(s.c_str()), 1));
+
+  //---
+
+  printf("{\n");
+
+  // escape kernel on generated code heavy document (15000 lines)
+  if (kernel) {
+    std::string code = codeDocument(15000);
+
+    printf("  \"kernels\": [\n");
+
+#ifdef __SSE2__
+    printKernel("escape_sse2", runKernel(code, /*simd*/true, minTime), /*last*/false);
+#endif
+    printKernel("escape_scalar", runKernel(code, /*simd*/false, minTime), /*last*/true);
+
+    printf("  ]%s\n", (html || text ? "," : ""));
+  }
+
+  std::vector<bool> formats;
+
+  if (html) formats.push_back(false);
+  if (text) formats.push_back(true);
+
+  for (size_t f = 0; f < formats.size(); ++f) {
+    bool tty = formats[f];
+
+    printf("  \"%s\": {\n", (tty ? "tty" : "html"));
+
+    // each corpus file
+    printf("   \"files\": [\n");
+
+    for (size_t i = 0; i < corpus.size(); ++i) {
+      const std::string &str = corpus[i].second;
+
+      Result result = runCase(corpus[i].first, [&]() { return str; }, tty, minTime);
+
+      result.scale = 1;
+
+      printResult(result, i == corpus.size() - 1);
+    }
+
+    printf("   ],\n");
+
+    // concatenated corpus
+    printf("   \"scaled\": [\n");
+
+    for (size_t i = 0; i < scales.size(); ++i) {
+      int scale = scales[i];
+
+      auto textFn = [&]() {
+        std::string str;
+
+        str.reserve(all.size()*size_t(scale));
+
+        for (int j = 0; j < scale; ++j)
+          str += all;
+
+        return str;
+      };
+
+      Result result = runCase("corpus", textFn, tty, minTime);
+
+      result.scale = scale;
+
+      printResult(result, i == scales.size() - 1);
+    }
+
+    printf("   ]\n");
+
+    printf("  }%s\n", (f == formats.size() - 1 ? "" : ","));
+  }
+
+  printf("}\n");
+
+  return 0;
+}
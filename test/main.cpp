@@ -1,38 +1,133 @@
-#include <CQMarkdownMain.h>
 #include <CMarkdown.h>
+#include <CMarkdownLinkDict.h>
+#include <CMarkdownTrace.h>
+#include <CMarkdownString.h>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// CQMARKDOWN_CLI builds conversion only program (no GUI libraries)
+#ifndef CQMARKDOWN_CLI
+#include <CQMarkdownMain.h>
 
 #ifdef CQ_APP_H
 #include <CQApp.h>
 #else
 #include <QApplication>
 #endif
+#endif
+
+namespace {
+
+void printStats(const CMarkdown::Stats &stats) {
+  using Phase = CMarkdown::Phase;
+
+  auto printTime = [&](const char *name, Phase phase) {
+    std::cerr << "  " << name << ": " << stats.time(phase) << " ms\n";
+  };
+
+  std::cerr << "Stats:\n";
+
+  printTime("Read        ", Phase::READ);
+  printTime("PreProcess  ", Phase::PREPROCESS);
+  printTime("Parse       ", Phase::PARSE);
+  printTime("Inline      ", Phase::INLINE);
+  printTime("Emit        ", Phase::EMIT);
+
+  std::cerr << "  Total       : " << stats.totalTime() << " ms\n";
+
+  std::cerr << "  Lines       : " << stats.lines       << "\n";
+  std::cerr << "  Link Lookups: " << stats.linkLookups << "\n";
+  std::cerr << "  Allocations : " << stats.allocations << "\n";
+  std::cerr << "  Output Bytes: " << stats.outputBytes << "\n";
+
+  std::cerr << "  Blocks:\n";
+
+  for (const auto &p : stats.blocks)
+    std::cerr << "    " << CMarkdown::typeName(p.first) << ": " << p.second << "\n";
+}
+
+// get terminal width for text output (stdout or stderr terminal when piped to pager,
+// then COLUMNS, default 80)
+int terminalWidth() {
+  for (int fd : { STDOUT_FILENO, STDERR_FILENO }) {
+    struct winsize ws;
+
+    if (isatty(fd) && ioctl(fd, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0)
+      return ws.ws_col;
+  }
+
+  const char *env = getenv("COLUMNS");
+
+  int w = (env ? atoi(env) : 0);
+
+  return (w > 0 ? w : 80);
+}
+
+// check for conversion to stdout (no application needed)
+bool isConvertArgs(int argc, char **argv) {
+#ifdef CQMARKDOWN_CLI
+  (void) argc; (void) argv;
+
+  return true;
+#else
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-html") == 0 || strcmp(argv[i], "-text") == 0)
+      return true;
+  }
+
+  return false;
+#endif
+}
+
+}
 
 int
 main(int argc, char **argv)
 {
+  // conversion runs without application object (or display)
+  bool convert = isConvertArgs(argc, argv);
+
+#ifndef CQMARKDOWN_CLI
 #ifdef CQ_APP_H
-  CQApp app(argc, argv);
+  CQApp *app = (! convert ? new CQApp(argc, argv) : nullptr);
 #else
-  QApplication app(argc, argv);
+  QApplication *app = (! convert ? new QApplication(argc, argv) : nullptr);
+#endif
 #endif
 
   bool html  = false; // output as html
   bool text  = false; // output as text
   bool ref   = false; // use reference implementation for compare
   bool debug = false; // debug
+  bool hlite = false; // highlight fenced code
+  bool spos  = false; // add source positions
+  bool ids   = false; // add heading ids
+  bool toc   = false; // replace [TOC] with table of contents
+  bool stats = false; // print conversion stats
+  int  width = -1;    // text output width (-1 for terminal width, 0 for no wrap)
 
-  QString filename;
+  std::string filename;
+  std::string traceFile; // trace events output file
+  std::string linksFile; // shared link definitions file
+  std::string saveLinks; // compiled link definitions output file
 
-  using TagValue = std::map<CMarkdownTagType,QString>;
+  using TagValue = std::map<CMarkdownTagType,std::string>;
 
   TagValue tagColor, tagFont;
 
   for (int i = 1; i < argc; ++i) {
     if (argv[i][0] == '-') {
-      QString arg(&argv[i][1]);
+      std::string arg(&argv[i][1]);
 
-      if      (arg == "html") {
+      // "-" reads from stdin
+      if      (arg == "") {
+        filename = "-";
+      }
+      else if (arg == "html") {
         html = true;
       }
       else if (arg == "text") {
@@ -44,15 +139,44 @@ main(int argc, char **argv)
       else if (arg == "debug") {
         debug = true;
       }
+      else if (arg == "highlight") {
+        hlite = true;
+      }
+      else if (arg == "sourcepos") {
+        spos = true;
+      }
+      else if (arg == "ids") {
+        ids = true;
+      }
+      else if (arg == "toc") {
+        toc = true;
+      }
+      else if (arg == "stats") {
+        stats = true;
+      }
+      else if (arg == "width") {
+        if (i < argc - 1)
+          width = std::max(atoi(argv[++i]), 0);
+      }
+      else if (arg == "trace") {
+        if (i < argc - 1)
+          traceFile = argv[++i];
+      }
+      else if (arg == "links") {
+        if (i < argc - 1)
+          linksFile = argv[++i];
+      }
+      else if (arg == "save-links") {
+        if (i < argc - 1)
+          saveLinks = argv[++i];
+      }
       else if (arg == "color") {
-        QString colorStr = argv[++i];
-
-        QStringList colorStrs = colorStr.split(";", Qt::KeepEmptyParts);
+        std::string colorStr = (i < argc - 1 ? argv[++i] : "");
 
-        for (int j = 0; j < colorStrs.length(); ++j) {
-          const QString colorStr1 = colorStrs[j];
+        std::vector<std::string> colorStrs = CMarkdownString::split(colorStr, ';');
 
-          QStringList colorStrs1 = colorStr1.split("=", Qt::KeepEmptyParts);
+        for (const auto &colorStr1 : colorStrs) {
+          std::vector<std::string> colorStrs1 = CMarkdownString::split(colorStr1, '=');
 
           if (colorStrs1.size() == 2) {
             CMarkdownTagType type = CMarkdown::stringToType(colorStrs1[0]);
@@ -60,22 +184,20 @@ main(int argc, char **argv)
             if (type != CMarkdownTagType::NONE)
               tagColor[type] = colorStrs1[1];
             else
-              std::cerr << "Invalid tag name '" << colorStrs1[0].toStdString() << "'\n";
+              std::cerr << "Invalid tag name '" << colorStrs1[0] << "'\n";
           }
           else {
-            std::cerr << "Invalid color string '" << colorStr1.toStdString() << "'\n";
+            std::cerr << "Invalid color string '" << colorStr1 << "'\n";
           }
         }
       }
       else if (arg == "font") {
-        QString fontStr = argv[++i];
-
-        QStringList fontStrs = fontStr.split(";", Qt::KeepEmptyParts);
+        std::string fontStr = (i < argc - 1 ? argv[++i] : "");
 
-        for (int j = 0; j < fontStrs.length(); ++j) {
-          const QString fontStr1 = fontStrs[j];
+        std::vector<std::string> fontStrs = CMarkdownString::split(fontStr, ';');
 
-          QStringList fontStrs1 = fontStr1.split("=", Qt::KeepEmptyParts);
+        for (const auto &fontStr1 : fontStrs) {
+          std::vector<std::string> fontStrs1 = CMarkdownString::split(fontStr1, '=');
 
           if (fontStrs1.size() == 2) {
             CMarkdownTagType type = CMarkdown::stringToType(fontStrs1[0]);
@@ -83,10 +205,10 @@ main(int argc, char **argv)
             if (type != CMarkdownTagType::NONE)
               tagFont[type] = fontStrs1[1];
             else
-              std::cerr << "Invalid tag name '" << fontStrs1[0].toStdString() << "'\n";
+              std::cerr << "Invalid tag name '" << fontStrs1[0] << "'\n";
           }
           else {
-            std::cerr << "Invalid font string '" << fontStr1.toStdString() << "'\n";
+            std::cerr << "Invalid font string '" << fontStr1 << "'\n";
           }
         }
       }
@@ -99,34 +221,79 @@ main(int argc, char **argv)
     }
   }
 
-  if (! html && ! text) {
+  // html output by default for conversion only program
+  if (convert && ! text)
+    html = true;
+
+  if (! convert) {
+#ifndef CQMARKDOWN_CLI
     CQMarkdownMain *markdown = new CQMarkdownMain(ref);
 
-    markdown->load(filename);
+    markdown->load(QString::fromStdString(filename));
 
     markdown->show();
 
-    return app.exec();
+    return app->exec();
+#else
+    (void) ref;
+#endif
   }
   else {
     CMarkdown markdown;
 
     markdown.setDebug(debug);
 
+    markdown.setHighlightCode(hlite);
+    markdown.setSourcePos(spos);
+    markdown.setHeadingIds(ids);
+    markdown.setToc(toc);
+    markdown.setStats(stats);
+
     for (const auto &p : tagColor)
       markdown.setTypeColor(p.first, p.second);
 
     for (const auto &p : tagFont)
       markdown.setTypeFont(p.first, p.second);
 
-    QString text;
+#ifdef CMARKDOWN_TRACE
+    if (traceFile != "")
+      CMarkdownTrace::setEnabled(true);
+#else
+    if (traceFile != "")
+      std::cerr << "Trace not supported (define CMARKDOWN_TRACE in CMarkdownConfig.h)\n";
+#endif
+
+    // shared link definitions (compiled dictionary is mapped, markdown is parsed)
+    if (linksFile != "") {
+      auto dict = std::make_shared<CMarkdownLinkDict>();
+
+      if (! dict->load(linksFile))
+        std::cerr << "Failed to read links '" << linksFile << "'\n";
+      else if (saveLinks != "" && ! dict->save(saveLinks))
+        std::cerr << "Failed to write links '" << saveLinks << "'\n";
+
+      markdown.setLinkDict(dict);
+    }
+
+    markdown.setTtyWidth(width >= 0 ? width : terminalWidth());
+
+    // write output as each block completes
+    markdown.setOutput(&std::cout);
+
+    std::string text;
 
     if (html)
       text = markdown.fileToHtml(filename);
     else
       text = markdown.fileToTty(filename);
 
-    std::cout << text.toStdString() << "\n";
+    std::cout << text << "\n";
+
+    if (stats)
+      printStats(markdown.stats());
+
+    if (CMarkdownTrace::isEnabled() && ! CMarkdownTrace::instance().save(traceFile))
+      std::cerr << "Failed to write trace '" << traceFile << "'\n";
 
     exit(0);
   }